@@ -0,0 +1,179 @@
+#ifndef CYCAMORE_SRC_ARCHETYPE_PERF_H_
+#define CYCAMORE_SRC_ARCHETYPE_PERF_H_
+
+#include <chrono>
+#include <set>
+#include <string>
+
+#include "cyclus.h"
+#include "datum_stage.h"
+
+namespace cycamore {
+
+/// The time step and exchange phases timed by ArchetypePerf
+enum PerfPhase {
+  PERF_TICK = 0,
+  PERF_GET_MATL_REQUESTS,
+  PERF_GET_MATL_BIDS,
+  PERF_ADJUST_MATL_PREFS,
+  PERF_GET_MATL_TRADES,
+  PERF_ACCEPT_MATL_TRADES,
+  PERF_TOCK,
+  PERF_NPHASES,
+};
+
+inline const char* PerfPhaseName(PerfPhase p) {
+  switch (p) {
+    case PERF_TICK:
+      return "Tick";
+    case PERF_GET_MATL_REQUESTS:
+      return "GetMatlRequests";
+    case PERF_GET_MATL_BIDS:
+      return "GetMatlBids";
+    case PERF_ADJUST_MATL_PREFS:
+      return "AdjustMatlPrefs";
+    case PERF_GET_MATL_TRADES:
+      return "GetMatlTrades";
+    case PERF_ACCEPT_MATL_TRADES:
+      return "AcceptMatlTrades";
+    case PERF_TOCK:
+      return "Tock";
+    default:
+      return "Unknown";
+  }
+}
+
+/// Accumulates per-phase wall time, call counts and item counts (requests,
+/// bids or materials touched) for one agent over one time step, and writes
+/// them to the ArchetypePerf table. Archetypes hold one of these and time
+/// their callbacks with a PerfScope.
+class ArchetypePerf {
+ public:
+  /// @param last the phase that ends an agent's time step; the step's
+  /// totals are recorded when a scope for this phase closes
+  ArchetypePerf(PerfPhase last = PERF_TOCK) : last_(last) { Reset_(); }
+
+  /// the phase that ends an agent's time step
+  PerfPhase last() const { return last_; }
+
+  /// adds one call of a phase
+  void Add(PerfPhase p, double seconds, int count) {
+    calls_[p]++;
+    secs_[p] += seconds;
+    counts_[p] += count;
+  }
+
+  /// writes a row for every phase called since the last record and resets
+  /// the totals.  Agents that may run concurrently have the rows staged.
+  void Record(cyclus::Agent* agent) {
+    ConcurrentTimeListener* c = dynamic_cast<ConcurrentTimeListener*>(agent);
+    if (c == NULL) {
+      Write_(agent);
+    } else {
+      ArchetypePerf totals(*this);
+      c->datum_stage().Write([agent, totals]() { totals.Write_(agent); });
+    }
+    Reset_();
+  }
+
+  /// the number of requests in a set of request portfolios
+  template <class T>
+  static int NRequests(
+      const std::set<typename cyclus::RequestPortfolio<T>::Ptr>& ports) {
+    int n = 0;
+    typename std::set<typename cyclus::RequestPortfolio<T>::Ptr>::
+        const_iterator it;
+    for (it = ports.begin(); it != ports.end(); ++it) {
+      n += (*it)->requests().size();
+    }
+    return n;
+  }
+
+  /// the number of bids in a set of bid portfolios
+  template <class T>
+  static int NBids(
+      const std::set<typename cyclus::BidPortfolio<T>::Ptr>& ports) {
+    int n = 0;
+    typename std::set<typename cyclus::BidPortfolio<T>::Ptr>::
+        const_iterator it;
+    for (it = ports.begin(); it != ports.end(); ++it) {
+      n += (*it)->bids().size();
+    }
+    return n;
+  }
+
+ private:
+  void Write_(cyclus::Agent* agent) const {
+    for (int i = 0; i < PERF_NPHASES; i++) {
+      if (calls_[i] == 0) {
+        continue;
+      }
+      agent->context()
+          ->NewDatum("ArchetypePerf")
+          ->AddVal("AgentId", agent->id())
+          ->AddVal("Time", agent->context()->time())
+          ->AddVal("Phase", std::string(PerfPhaseName(PerfPhase(i))))
+          ->AddVal("Calls", calls_[i])
+          ->AddVal("Seconds", secs_[i])
+          ->AddVal("Count", counts_[i])
+          ->Record();
+    }
+  }
+
+  void Reset_() {
+    for (int i = 0; i < PERF_NPHASES; i++) {
+      calls_[i] = 0;
+      secs_[i] = 0;
+      counts_[i] = 0;
+    }
+  }
+
+  PerfPhase last_;
+  int calls_[PERF_NPHASES];
+  double secs_[PERF_NPHASES];
+  int counts_[PERF_NPHASES];
+};
+
+/// Times one call of a phase for the lifetime of the scope. When disabled,
+/// the scope does nothing beyond a single branch on construction and
+/// destruction.
+class PerfScope {
+ public:
+  /// @param perf the totals to add the call to
+  /// @param on whether performance recording is enabled for the agent
+  /// @param phase the phase being timed
+  /// @param agent the agent the totals are recorded for
+  PerfScope(ArchetypePerf* perf, bool on, PerfPhase phase,
+            cyclus::Agent* agent)
+      : perf_(on ? perf : NULL), phase_(phase), agent_(agent), count_(0) {
+    if (perf_ != NULL) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~PerfScope() {
+    if (perf_ == NULL) {
+      return;
+    }
+    std::chrono::duration<double> dt =
+        std::chrono::steady_clock::now() - start_;
+    perf_->Add(phase_, dt.count(), count_);
+    if (phase_ == perf_->last()) {
+      perf_->Record(agent_);
+    }
+  }
+
+  /// sets the number of requests, bids or materials handled by this call
+  void Count(int n) { count_ = n; }
+
+ private:
+  ArchetypePerf* perf_;
+  PerfPhase phase_;
+  cyclus::Agent* agent_;
+  int count_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_ARCHETYPE_PERF_H_
@@ -0,0 +1,80 @@
+#ifndef CYCAMORE_SRC_DATUM_STAGE_H_
+#define CYCAMORE_SRC_DATUM_STAGE_H_
+
+#include <functional>
+#include <vector>
+
+namespace cycamore {
+
+/// DatumStage defers an agent's writes to the output database.  While the
+/// stage is held, each write is kept, in order, instead of being made, and
+/// releasing the stage makes them.  When the stage is not held writes are made
+/// immediately, so an agent that routes its writes through a stage behaves
+/// exactly as before unless something holds it.
+class DatumStage {
+ public:
+  DatumStage() : held_(false) {}
+
+  /// starts keeping writes
+  void Hold() { held_ = true; }
+
+  /// makes every kept write in the order they were staged and stops keeping
+  /// writes
+  void Release() {
+    held_ = false;
+    for (int i = 0; i < staged_.size(); i++) {
+      staged_[i]();
+    }
+    staged_.clear();
+  }
+
+  /// true if writes are currently being kept
+  bool held() const { return held_; }
+
+  /// makes a write now, or keeps it until Release if the stage is held.  The
+  /// write is made within the same time step, so it may read the current
+  /// time from the context when it is made.
+  void Write(const std::function<void()>& w) {
+    if (held_) {
+      staged_.push_back(w);
+    } else {
+      w();
+    }
+  }
+
+ private:
+  bool held_;
+  std::vector<std::function<void()> > staged_;
+};
+
+/// ConcurrentTimeListener marks an archetype whose Tick and Tock touch only
+/// its own state and which routes every datum it records during them through
+/// its DatumStage, so that a kernel may run Tick or Tock for many such agents
+/// at once on several threads.
+///
+/// A kernel doing so must call BeginConcurrent on each agent before the
+/// concurrent phase and EndConcurrent on each agent after it, both serially
+/// and in a deterministic order, so that output tables are written the same
+/// way on every run.  Resources created, split or transmuted during the phase
+/// are still recorded by the kernel itself, which must make that bookkeeping
+/// safe on its side.
+class ConcurrentTimeListener {
+ public:
+  virtual ~ConcurrentTimeListener() {}
+
+  /// starts staging this agent's datums for a concurrent phase
+  void BeginConcurrent() { datum_stage_.Hold(); }
+
+  /// records the datums staged during a concurrent phase
+  void EndConcurrent() { datum_stage_.Release(); }
+
+  /// the stage this agent's datums are written through
+  DatumStage& datum_stage() { return datum_stage_; }
+
+ protected:
+  DatumStage datum_stage_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_DATUM_STAGE_H_
@@ -9,29 +9,37 @@ DeployInst::~DeployInst() {}
 
 void DeployInst::Build(cyclus::Agent* parent) {
   cyclus::Institution::Build(parent);
-  BuildSched::iterator it;
+
+  // one probe agent per distinct prototype tells us its original lifetime;
+  // the probe is then reused as the first lifetime variant that needs one
+  std::map<std::string, cyclus::Agent*> probes;
+  std::map<std::string, int> base_lifetimes;
   std::set<std::string> protos;
+  bool override_lifetimes = lifetimes.size() == prototypes.size();
   for (int i = 0; i < prototypes.size(); i++) {
     std::string proto = prototypes[i];
 
-    std::stringstream ss;
-    ss << proto;
-
-    if (lifetimes.size() == prototypes.size()) {
-      cyclus::Agent* a = context()->CreateAgent<Agent>(proto);
-      if (a->lifetime() != lifetimes[i]) {
-        a->lifetime(lifetimes[i]);
+    if (override_lifetimes) {
+      if (base_lifetimes.count(proto) == 0) {
+        cyclus::Agent* a = context()->CreateAgent<Agent>(proto);
+        base_lifetimes[proto] = a->lifetime();
+        probes[proto] = a;
+      }
 
-        if (lifetimes[i] == -1) {
-          ss << "_life_forever";
-        } else {
-          ss << "_life_" << lifetimes[i];
-        }
-        proto = ss.str();
-        if (protos.count(proto) == 0) {
-          protos.insert(proto);
-          context()->AddPrototype(proto, a);
+      if (base_lifetimes[proto] != lifetimes[i]) {
+        std::string variant = LifetimeVariant_(proto, lifetimes[i]);
+        if (protos.count(variant) == 0) {
+          protos.insert(variant);
+          cyclus::Agent* a = probes[proto];
+          if (a != NULL) {
+            probes[proto] = NULL;
+          } else {
+            a = context()->CreateAgent<Agent>(proto);
+          }
+          a->lifetime(lifetimes[i]);
+          context()->AddPrototype(variant, a);
         }
+        proto = variant;
       }
     }
 
@@ -40,6 +48,24 @@ void DeployInst::Build(cyclus::Agent* parent) {
       context()->SchedBuild(this, proto, t);
     }
   }
+
+  std::map<std::string, cyclus::Agent*>::iterator it;
+  for (it = probes.begin(); it != probes.end(); ++it) {
+    if (it->second != NULL)
+      context()->DelAgent(it->second);
+  }
+}
+
+std::string DeployInst::LifetimeVariant_(const std::string& proto,
+                                         int lifetime) {
+  std::stringstream ss;
+  ss << proto;
+  if (lifetime == -1) {
+    ss << "_life_forever";
+  } else {
+    ss << "_life_" << lifetime;
+  }
+  return ss.str();
 }
 
 void DeployInst::EnterNotify() {
@@ -4,6 +4,7 @@
 #include <utility>
 #include <set>
 #include <map>
+#include <string>
 
 #include "cyclus.h"
 #include "cycamore_version.h"
@@ -45,6 +46,9 @@ class DeployInst : public cyclus::Institution {
   virtual void EnterNotify();
 
  protected:
+  /// the name of the prototype registered for a lifetime override
+  std::string LifetimeVariant_(const std::string& proto, int lifetime);
+
   #pragma cyclus var { \
     "doc": "Ordered list of prototypes to build.", \
     "uitype": ("oneormore", "prototype"), \
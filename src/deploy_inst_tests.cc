@@ -138,6 +138,40 @@ TEST(DeployInstTests, NoDupProtos) {
   EXPECT_EQ(1, stmt->GetInt(0));
 }
 
+// several lifetime variants of one prototype each get their own prototype
+// and lifetime
+TEST(DeployInstTests, LifetimeVariants) {
+  std::string config =
+     "<prototypes>  <val>foobar</val> <val>foobar</val> <val>foobar</val> </prototypes>"
+     "<build_times> <val>1</val>      <val>1</val>      <val>1</val>      </build_times>"
+     "<n_build>     <val>2</val>      <val>3</val>      <val>4</val>      </n_build>"
+     "<lifetimes>   <val>1</val>      <val>2</val>      <val>1</val>      </lifetimes>"
+     ;
+
+  int simdur = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:DeployInst"), config, simdur);
+  sim.DummyProto("foobar");
+  int id = sim.Run();
+
+  cyclus::SqlStatement::Ptr stmt = sim.db().db().Prepare(
+      "SELECT COUNT(*) FROM Prototypes WHERE Prototype LIKE 'foobar_life_%';"
+      );
+  stmt->Step();
+  EXPECT_EQ(2, stmt->GetInt(0));
+
+  stmt = sim.db().db().Prepare(
+      "SELECT COUNT(*) FROM AgentEntry WHERE Prototype = 'foobar' AND Lifetime = 1;"
+      );
+  stmt->Step();
+  EXPECT_EQ(6, stmt->GetInt(0));
+
+  stmt = sim.db().db().Prepare(
+      "SELECT COUNT(*) FROM AgentEntry WHERE Prototype = 'foobar' AND Lifetime = 2;"
+      );
+  stmt->Step();
+  EXPECT_EQ(3, stmt->GetInt(0));
+}
+
 // required to get functionality in cyclus agent unit tests library
 cyclus::Agent* DeployInstitutionConstructor(cyclus::Context* ctx) {
   return new cycamore::DeployInst(ctx);
@@ -22,7 +22,18 @@ Enrichment::Enrichment(cyclus::Context* ctx)
       feed_recipe(""),
       product_commod(""),
       tails_commod(""),
-      order_prefs(true) {}
+      order_prefs(true),
+      compact_tails(false),
+      bin_feed(false),
+      aggregate_tails_bids(false),
+      aggregate_enrichments(false),
+      record_perf(false),
+      footprint_interval(0),
+      intra_timestep_product_(0),
+      intra_timestep_trades_(0),
+      feed_u235_(0),
+      feed_u238_(0),
+      feed_qty_(0) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Enrichment::~Enrichment() {}
@@ -45,8 +56,10 @@ void Enrichment::Build(cyclus::Agent* parent) {
 
   Facility::Build(parent);
   if (initial_feed > 0) {
-    inventory.Push(Material::Create(this, initial_feed,
-                                    context()->GetRecipe(feed_recipe)));
+    Material::Ptr feed = Material::Create(
+        this, initial_feed, feed_rec_.Get(context(), feed_recipe));
+    inventory.Push(feed);
+    TrackFeed_(feed, 1);
   }
 
   LOG(cyclus::LEV_DEBUG2, "EnrFac") << "Enrichment "
@@ -55,22 +68,41 @@ void Enrichment::Build(cyclus::Agent* parent) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Enrichment::Tick() { current_swu_capacity = SwuCapacity(); }
+void Enrichment::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
+  current_swu_capacity = SwuCapacity();
+}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  RecordFootprint_();
   using cyclus::toolkit::RecordTimeSeries;
   LOG(cyclus::LEV_INFO4, "EnrFac") << prototype() << " used "
                                    << intra_timestep_swu_ << " SWU";
-  RecordTimeSeries<cyclus::toolkit::ENRICH_SWU>(this, intra_timestep_swu_);
   LOG(cyclus::LEV_INFO4, "EnrFac") << prototype() << " used "
                                    << intra_timestep_feed_ << " feed";
-  RecordTimeSeries<cyclus::toolkit::ENRICH_FEED>(this, intra_timestep_feed_);
+  double swu = intra_timestep_swu_;
+  double feed = intra_timestep_feed_;
+  datum_stage_.Write([this, swu, feed]() {
+    RecordTimeSeries<cyclus::toolkit::ENRICH_SWU>(this, swu);
+    RecordTimeSeries<cyclus::toolkit::ENRICH_FEED>(this, feed);
+  });
+  if (aggregate_enrichments) {
+    RecordEnrichmentTotals_();
+  }
+  LOG(cyclus::LEV_INFO4, "EnrFac") << prototype()
+                                   << " enrichment cache hit rate: "
+                                   << enrich_cache_.hit_rate();
+  if (compact_tails) {
+    CompactTails_();
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Enrichment::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::Material;
   using cyclus::RequestPortfolio;
   using cyclus::Request;
@@ -85,26 +117,22 @@ Enrichment::GetMatlRequests() {
     ports.insert(port);
   }
 
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
   return ports;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-bool SortBids(cyclus::Bid<cyclus::Material>* i,
-              cyclus::Bid<cyclus::Material>* j) {
-  cyclus::Material::Ptr mat_i = i->offer();
-  cyclus::Material::Ptr mat_j = j->offer();
-
-  cyclus::toolkit::MatQuery mq_i(mat_i);
-  cyclus::toolkit::MatQuery mq_j(mat_j);
-
-  return ((mq_i.mass(922350000) / mq_i.qty()) <=
-          (mq_j.mass(922350000) / mq_j.qty()));
+bool SortBids(const std::pair<double, cyclus::Bid<cyclus::Material>*>& i,
+              const std::pair<double, cyclus::Bid<cyclus::Material>*>& j) {
+  return i.first < j.first;
 }
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // Sort offers of input material to have higher preference for more
 //  U-235 content
 void Enrichment::AdjustMatlPrefs(
     cyclus::PrefMap<cyclus::Material>::type& prefs) {
+  PerfScope scope(&perf_, record_perf, PERF_ADJUST_MATL_PREFS, this);
+  scope.Count(prefs.size());
   using cyclus::Bid;
   using cyclus::Material;
   using cyclus::Request;
@@ -113,20 +141,32 @@ void Enrichment::AdjustMatlPrefs(
     return;
   }
 
+  // U-235 mass fraction of each offer, computed once per composition and
+  // shared by every request
+  std::map<int, double> u235_fracs;
+
   cyclus::PrefMap<cyclus::Material>::type::iterator reqit;
 
   // Loop over all requests
   for (reqit = prefs.begin(); reqit != prefs.end(); ++reqit) {
-    std::vector<Bid<Material>*> bids_vector;
+    std::vector<std::pair<double, Bid<Material>*> > bids_vector;
+    bids_vector.reserve(reqit->second.size());
     std::map<Bid<Material>*, double>::iterator mit;
     for (mit = reqit->second.begin(); mit != reqit->second.end(); ++mit) {
       Bid<Material>* bid = mit->first;
-      bids_vector.push_back(bid);
+      Material::Ptr mat = bid->offer();
+      int comp_id = mat->comp()->id();
+      std::map<int, double>::iterator fit = u235_fracs.find(comp_id);
+      if (fit == u235_fracs.end()) {
+        cyclus::toolkit::MatQuery mq(mat);
+        double frac = mq.qty() > 0 ? mq.mass(922350000) / mq.qty() : 0;
+        fit = u235_fracs.insert(std::make_pair(comp_id, frac)).first;
+      }
+      bids_vector.push_back(std::make_pair(fit->second, bid));
     }
-    std::sort(bids_vector.begin(), bids_vector.end(), SortBids);
+    std::stable_sort(bids_vector.begin(), bids_vector.end(), SortBids);
 
     // Assign preferences to the sorted vector
-    double n_bids = bids_vector.size();
     bool u235_mass = 0;
 
     for (int bidit = 0; bidit < bids_vector.size(); bidit++) {
@@ -134,15 +174,13 @@ void Enrichment::AdjustMatlPrefs(
 
       // For any bids with U-235 qty=0, set pref to zero.
       if (!u235_mass) {
-        cyclus::Material::Ptr mat = bids_vector[bidit]->offer();
-        cyclus::toolkit::MatQuery mq(mat);
-        if (mq.mass(922350000) == 0) {
+        if (bids_vector[bidit].first == 0) {
           new_pref = -1;
         } else {
           u235_mass = true;
         }
       }
-      (reqit->second)[bids_vector[bidit]] = new_pref;
+      (reqit->second)[bids_vector[bidit].second] = new_pref;
     }  // each bid
   }    // each Material Request
 }
@@ -151,6 +189,8 @@ void Enrichment::AdjustMatlPrefs(
 void Enrichment::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                                 cyclus::Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   // see
   // http://stackoverflow.com/questions/5181183/boostshared-ptr-and-inheritance
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
@@ -163,6 +203,7 @@ void Enrichment::AcceptMatlTrades(
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
     cyclus::CommodMap<cyclus::Material>::type& out_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
   using cyclus::Bid;
   using cyclus::BidPortfolio;
   using cyclus::CapacityConstraint;
@@ -178,16 +219,33 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
 
     std::vector<Request<Material>*>& tails_requests =
         out_requests[tails_commod];
+
+    // snapshot the tails inventory once for all requests
+    MatVec mats = tails.PopN(tails.count());
+    tails.Push(mats);
+
+    Material::Ptr blend;
+    if (aggregate_tails_bids) {
+      blend = Material::CreateUntracked(0, mats[0]->comp());
+      for (int k = 0; k < mats.size(); k++) {
+        blend->Absorb(
+            Material::CreateUntracked(mats[k]->quantity(), mats[k]->comp()));
+      }
+    }
+
     std::vector<Request<Material>*>::iterator it;
     for (it = tails_requests.begin(); it != tails_requests.end(); ++it) {
+      Request<Material>* req = *it;
+      if (aggregate_tails_bids) {
+        double qty = std::min(req->target()->quantity(), blend->quantity());
+        tails_port->AddBid(req, Material::CreateUntracked(qty, blend->comp()),
+                           this);
+        continue;
+      }
       // offer bids for all tails material, keeping discrete quantities
       // to preserve possible variation in composition
-      MatVec mats = tails.PopN(tails.count());
-      tails.Push(mats);
       for (int k = 0; k < mats.size(); k++) {
-        Material::Ptr m = mats[k];
-        Request<Material>* req = *it;
-        tails_port->AddBid(req, m, this);
+        tails_port->AddBid(req, mats[k], this);
       }
     }
     // overbidding (bidding on every offer)
@@ -203,34 +261,56 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
   if ((out_requests.count(product_commod) > 0) && (inventory.quantity() > 0)) {
     BidPortfolio<Material>::Ptr commod_port(new BidPortfolio<Material>());
 
+    MatVec offers;
     std::vector<Request<Material>*>& commod_requests =
         out_requests[product_commod];
     std::vector<Request<Material>*>::iterator it;
     for (it = commod_requests.begin(); it != commod_requests.end(); ++it) {
       Request<Material>* req = *it;
       Material::Ptr mat = req->target();
-      double request_enrich = cyclus::toolkit::UraniumAssayMass(mat);
+      double request_enrich = enrich_cache_.Assay(mat->comp());
       if (ValidReq(req->target()) &&
           ((request_enrich < max_enrich) ||
            (cyclus::AlmostEq(request_enrich, max_enrich)))) {
         Material::Ptr offer = Offer_(req->target());
         commod_port->AddBid(req, offer, this);
+        offers.push_back(offer);
       }
     }
 
-    Converter<Material>::Ptr sc(new SWUConverter(FeedAssay(), tails_assay));
-    Converter<Material>::Ptr nc(new NatUConverter(FeedAssay(), tails_assay));
+    double feed_assay = FeedAssay();
+    Converter<Material>::Ptr sc(
+        new SWUConverter(feed_assay, tails_assay, &enrich_cache_));
+    Converter<Material>::Ptr nc(
+        new NatUConverter(feed_assay, tails_assay, &enrich_cache_));
     CapacityConstraint<Material> swu(swu_capacity, sc);
     CapacityConstraint<Material> natu(inventory.quantity(), nc);
     commod_port->AddConstraint(swu);
     commod_port->AddConstraint(natu);
 
+    // evaluate every offer up front so the solver's per-arc conversions are
+    // all cache hits
+    std::vector<double> swu_reqs;
+    std::vector<double> natu_reqs;
+    enrich_cache_.Convert(offers, feed_assay, tails_assay, &swu_reqs,
+                          &natu_reqs);
+    double swu_tot = 0;
+    double natu_tot = 0;
+    for (int i = 0; i < swu_reqs.size(); ++i) {
+      swu_tot += swu_reqs[i];
+      natu_tot += natu_reqs[i];
+    }
+    LOG(cyclus::LEV_INFO5, "EnrFac")
+        << prototype() << " bidding on requests needing " << swu_tot
+        << " SWU and " << natu_tot << " natu";
+
     LOG(cyclus::LEV_INFO5, "EnrFac")
         << prototype() << " adding a swu constraint of " << swu.capacity();
     LOG(cyclus::LEV_INFO5, "EnrFac")
         << prototype() << " adding a natu constraint of " << natu.capacity();
     ports.insert(commod_port);
   }
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
   return ports;
 }
 
@@ -247,11 +327,15 @@ void Enrichment::GetMatlTrades(
     const std::vector<cyclus::Trade<cyclus::Material> >& trades,
     std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                           cyclus::Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
   using cyclus::Material;
   using cyclus::Trade;
 
   intra_timestep_swu_ = 0;
   intra_timestep_feed_ = 0;
+  intra_timestep_product_ = 0;
+  intra_timestep_trades_ = 0;
 
   std::vector<Trade<Material> >::const_iterator it;
   for (it = trades.begin(); it != trades.end(); ++it) {
@@ -290,25 +374,13 @@ void Enrichment::GetMatlTrades(
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::AddMat_(cyclus::Material::Ptr mat) {
   // Elements and isotopes other than U-235, U-238 are sent directly to tails
-  cyclus::CompMap cm = mat->comp()->atom();
-  bool extra_u = false;
-  bool other_elem = false;
-  for (cyclus::CompMap::const_iterator it = cm.begin(); it != cm.end(); ++it) {
-    if (pyne::nucname::znum(it->first) == 92) {
-      if (pyne::nucname::anum(it->first) != 235 &&
-          pyne::nucname::anum(it->first) != 238 && it->second > 0) {
-        extra_u = true;
-      }
-    } else if (it->second > 0) {
-      other_elem = true;
-    }
-  }
-  if (extra_u) {
+  int flags = FeedFlags_(mat->comp());
+  if (flags & EXTRA_U) {
     cyclus::Warn<cyclus::VALUE_WARNING>(
         "More than 2 isotopes of U.  "
         "Istopes other than U-235, U-238 are sent directly to tails.");
   }
-  if (other_elem) {
+  if (flags & OTHER_ELEM) {
     cyclus::Warn<cyclus::VALUE_WARNING>(
         "Non-uranium elements are "
         "sent directly to tails.");
@@ -318,11 +390,16 @@ void Enrichment::AddMat_(cyclus::Material::Ptr mat) {
                                    << inventory.quantity() << " total.";
 
   try {
-    inventory.Push(mat);
+    if (bin_feed) {
+      BinFeed_(mat);
+    } else {
+      inventory.Push(mat);
+    }
   } catch (cyclus::Error& e) {
     e.msg(Agent::InformErrorMsg(e.msg()));
     throw e;
   }
+  TrackFeed_(mat, 1);
 
   LOG(cyclus::LEV_INFO5, "EnrFac")
       << prototype() << " added " << mat->quantity() << " of " << feed_commod
@@ -330,11 +407,42 @@ void Enrichment::AddMat_(cyclus::Material::Ptr mat) {
       << " total.";
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int Enrichment::FeedFlags_(cyclus::Composition::Ptr c) {
+  std::map<int, int>::iterator fit = feed_flags_.find(c->id());
+  if (fit != feed_flags_.end()) {
+    return fit->second;
+  }
+
+  int flags = 0;
+  const cyclus::CompMap& cm = c->atom();
+  for (cyclus::CompMap::const_iterator it = cm.begin(); it != cm.end(); ++it) {
+    if (it->second <= 0) {
+      continue;
+    }
+    if (pyne::nucname::znum(it->first) == 92) {
+      int a = pyne::nucname::anum(it->first);
+      if (a != 235 && a != 238) {
+        flags |= EXTRA_U;
+      }
+    } else {
+      flags |= OTHER_ELEM;
+    }
+  }
+  // mixed feeds bring a new composition with every receipt, so the memo is
+  // bounded like the enrichment cache
+  if (static_cast<int>(feed_flags_.size()) >= enrich_cache_.max_size()) {
+    feed_flags_.clear();
+  }
+  feed_flags_[c->id()] = flags;
+  return flags;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 cyclus::Material::Ptr Enrichment::Request_() {
   double qty = std::max(0.0, inventory.capacity() - inventory.quantity());
-  return cyclus::Material::CreateUntracked(qty,
-                                           context()->GetRecipe(feed_recipe));
+  return cyclus::Material::CreateUntracked(
+      qty, feed_rec_.Get(context(), feed_recipe));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -352,38 +460,39 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
   using cyclus::Material;
   using cyclus::ResCast;
   using cyclus::toolkit::Assays;
-  using cyclus::toolkit::UraniumAssayMass;
-  using cyclus::toolkit::SwuRequired;
-  using cyclus::toolkit::FeedQty;
   using cyclus::toolkit::TailsQty;
 
+  double product = enrich_cache_.Assay(mat->comp());
+  double feed_assay = FeedAssay();
+  double ufrac = NatUFrac();
+  Material::Ptr r;
+  if (bin_feed) {
+    r = PopFeedBin_(qty, product, &feed_assay, &ufrac);
+  }
+
   // get enrichment parameters
-  Assays assays(FeedAssay(), UraniumAssayMass(mat), tails_assay);
-  double swu_req = SwuRequired(qty, assays);
-  double natu_req = FeedQty(qty, assays);
+  Assays assays(feed_assay, product, tails_assay);
+  double swu_req = qty * enrich_cache_.SwuPerKg(assays.Product(),
+                                                assays.Feed(), assays.Tails());
+  double natu_req = qty * enrich_cache_.FeedPerKg(
+                              assays.Product(), assays.Feed(), assays.Tails());
 
   // Determine the composition of the natural uranium
   // (ie. U-235+U-238/TotalMass)
-  double pop_qty = inventory.quantity();
-  Material::Ptr natu_matl = inventory.Pop(pop_qty, cyclus::eps_rsrc());
-  inventory.Push(natu_matl);
+  double feed_req = natu_req / ufrac;
 
-  cyclus::toolkit::MatQuery mq(natu_matl);
-  std::set<cyclus::Nuc> nucs;
-  nucs.insert(922350000);
-  nucs.insert(922380000);
-  double natu_frac = mq.mass_frac(nucs);
-  double feed_req = natu_req / natu_frac;
-
-  // pop amount from inventory and blob it into one material
-  Material::Ptr r;
+  // pop amount from inventory and blob it into one material, unless it was
+  // already drawn from a single feed bin
   try {
-    // required so popping doesn't take out too much
-    if (cyclus::AlmostEq(feed_req, inventory.quantity())) {
-      r = cyclus::toolkit::Squash(inventory.PopN(inventory.count()));
-    } else {
-      r = inventory.Pop(feed_req, cyclus::eps_rsrc());
+    if (r.get() == NULL) {
+      // required so popping doesn't take out too much
+      if (cyclus::AlmostEq(feed_req, inventory.quantity())) {
+        r = cyclus::toolkit::Squash(inventory.PopN(inventory.count()));
+      } else {
+        r = inventory.Pop(feed_req, cyclus::eps_rsrc());
+      }
     }
+    TrackFeed_(r, -1);
   } catch (cyclus::Error& e) {
     NatUConverter nc(FeedAssay(), tails_assay);
     std::stringstream ss;
@@ -404,7 +513,11 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
 
   intra_timestep_swu_ += swu_req;
   intra_timestep_feed_ += feed_req;
-  RecordEnrichment_(feed_req, swu_req);
+  intra_timestep_product_ += qty;
+  intra_timestep_trades_++;
+  if (!aggregate_enrichments) {
+    RecordEnrichment_(feed_req, swu_req);
+  }
 
   LOG(cyclus::LEV_INFO5, "EnrFac") << prototype()
                                    << " has performed an enrichment: ";
@@ -425,6 +538,116 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
   return response;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::RecordFootprint_() {
+  if (!InventoryFootprint::Due(footprint_interval, context()->time())) {
+    return;
+  }
+  InventoryFootprint fp;
+  fp.AddBuf("inventory", &inventory);
+  fp.AddBuf("tails", &tails);
+  fp.Record(this);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::CompactTails_() {
+  using cyclus::Material;
+  using cyclus::toolkit::MatVec;
+
+  if (tails.count() < 2) {
+    return;
+  }
+
+  // tails are all enriched down to (nearly) the same assay, so there are
+  // only ever a handful of distinct groups
+  MatVec mats = tails.PopN(tails.count());
+  MatVec merged;
+  std::vector<double> assays;
+  for (int i = 0; i < mats.size(); ++i) {
+    double assay = cyclus::toolkit::UraniumAssayMass(mats[i]);
+    int j = 0;
+    while (j < assays.size() && !cyclus::AlmostEq(assays[j], assay)) {
+      ++j;
+    }
+    if (j < assays.size()) {
+      merged[j]->Absorb(mats[i]);
+    } else {
+      merged.push_back(mats[i]);
+      assays.push_back(assay);
+    }
+  }
+  tails.Push(merged);
+
+  LOG(cyclus::LEV_DEBUG2, "EnrFac") << prototype() << " compacted "
+                                    << mats.size() << " tails materials into "
+                                    << merged.size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::BinFeed_(cyclus::Material::Ptr mat) {
+  // let the inventory reject feed that doesn't fit before any bin is touched
+  if (inventory.empty() || mat->quantity() > inventory.space()) {
+    inventory.Push(mat);
+    return;
+  }
+
+  double assay = enrich_cache_.Assay(mat->comp());
+  cyclus::toolkit::MatVec bins = inventory.PopN(inventory.count());
+  for (int i = 0; i < bins.size(); ++i) {
+    if (cyclus::AlmostEq(enrich_cache_.Assay(bins[i]->comp()), assay)) {
+      bins[i]->Absorb(mat);
+      mat.reset();
+      break;
+    }
+  }
+  inventory.Push(bins);
+  if (mat.get() != NULL) {
+    inventory.Push(mat);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+cyclus::Material::Ptr Enrichment::PopFeedBin_(double qty, double product,
+                                              double* feed_assay,
+                                              double* ufrac) {
+  using cyclus::Material;
+
+  double blend = *feed_assay;
+  cyclus::toolkit::MatVec bins = inventory.PopN(inventory.count());
+  int best = -1;
+  double best_assay = 0;
+  double best_feed = 0;
+  for (int i = 0; i < bins.size(); ++i) {
+    double assay = enrich_cache_.Assay(bins[i]->comp());
+    if ((assay < blend && !cyclus::AlmostEq(assay, blend)) ||
+        assay >= product || assay <= tails_assay ||
+        (best >= 0 && assay <= best_assay)) {
+      continue;
+    }
+    double feed = qty * enrich_cache_.FeedPerKg(product, assay, tails_assay) /
+                  enrich_cache_.UFrac(bins[i]->comp());
+    if (feed <= bins[i]->quantity() + cyclus::eps_rsrc()) {
+      best = i;
+      best_assay = assay;
+      best_feed = feed;
+    }
+  }
+
+  Material::Ptr r;
+  if (best >= 0) {
+    *feed_assay = best_assay;
+    *ufrac = enrich_cache_.UFrac(bins[best]->comp());
+    if (best_feed < bins[best]->quantity() - cyclus::eps_rsrc()) {
+      r = bins[best]->ExtractQty(best_feed);
+    } else {
+      r = bins[best];
+      bins.erase(bins.begin() + best);
+    }
+  }
+  inventory.Push(bins);
+  return r;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::RecordEnrichment_(double natural_u, double swu) {
   using cyclus::Context;
@@ -443,18 +666,191 @@ void Enrichment::RecordEnrichment_(double natural_u, double swu) {
       ->AddVal("SWU", swu)
       ->Record();
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::RecordEnrichmentTotals_() {
+  if (intra_timestep_trades_ == 0) {
+    return;
+  }
+  double feed = intra_timestep_feed_;
+  double swu = intra_timestep_swu_;
+  double product = intra_timestep_product_;
+  int n = intra_timestep_trades_;
+  // totals are only valid until the next GetMatlTrades resets them
+  intra_timestep_trades_ = 0;
+
+  datum_stage_.Write([this, feed, swu, product, n]() {
+    context()
+        ->NewDatum("EnrichmentTotals")
+        ->AddVal("ID", id())
+        ->AddVal("Time", context()->time())
+        ->AddVal("Natural_Uranium", feed)
+        ->AddVal("SWU", swu)
+        ->AddVal("Product", product)
+        ->AddVal("NTrades", n)
+        ->Record();
+  });
+}
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double Enrichment::FeedAssay() {
-  using cyclus::Material;
+  SyncFeed_();
+  double u = feed_u235_ + feed_u238_;
+  if (inventory.empty() || u <= 0) {
+    return 0;
+  }
+  return feed_u235_ / u;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double Enrichment::NatUFrac() {
+  SyncFeed_();
+  if (feed_qty_ <= 0) {
+    return 0;
+  }
+  return (feed_u235_ + feed_u238_) / feed_qty_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::TrackFeed_(cyclus::Material::Ptr mat, double sign) {
+  cyclus::toolkit::MatQuery mq(mat);
+  feed_u235_ += sign * mq.mass(922350000);
+  feed_u238_ += sign * mq.mass(922380000);
+  feed_qty_ += sign * mat->quantity();
+
+  if (inventory.empty()) {
+    // drop any accumulated round-off once the inventory is drained
+    feed_u235_ = 0;
+    feed_u238_ = 0;
+    feed_qty_ = 0;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::SyncFeed_() {
+  if (cyclus::AlmostEq(feed_qty_, inventory.quantity())) {
+    return;
+  }
 
+  feed_u235_ = 0;
+  feed_u238_ = 0;
+  feed_qty_ = 0;
   if (inventory.empty()) {
+    return;
+  }
+  cyclus::toolkit::MatVec mats = inventory.PopN(inventory.count());
+  inventory.Push(mats);
+  for (int i = 0; i < mats.size(); ++i) {
+    TrackFeed_(mats[i], 1);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+EnrichmentCache::EnrichmentCache(int max_size)
+    : max_size_(max_size), hits_(0), misses_(0) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool EnrichmentCache::AssayKey::operator<(const AssayKey& other) const {
+  if (product != other.product) {
+    return product < other.product;
+  } else if (feed != other.feed) {
+    return feed < other.feed;
+  }
+  return tails < other.tails;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentCache::SwuPerKg(double product, double feed, double tails) {
+  return Lookup(product, feed, tails).swu;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentCache::FeedPerKg(double product, double feed, double tails) {
+  return Lookup(product, feed, tails).feed;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentCache::Assay(cyclus::Composition::Ptr c) {
+  return Lookup(c).assay;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentCache::UFrac(cyclus::Composition::Ptr c) {
+  return Lookup(c).ufrac;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void EnrichmentCache::Convert(const std::vector<cyclus::Material::Ptr>& mats,
+                              double feed, double tails,
+                              std::vector<double>* swu,
+                              std::vector<double>* natu) {
+  swu->resize(mats.size());
+  natu->resize(mats.size());
+  for (int i = 0; i < mats.size(); ++i) {
+    const CompEntry& c = Lookup(mats[i]->comp());
+    const Entry& e = Lookup(c.assay, feed, tails);
+    double qty = mats[i]->quantity();
+    (*swu)[i] = qty * e.swu;
+    (*natu)[i] = qty * e.feed / c.ufrac;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentCache::hit_rate() const {
+  if (hits_ + misses_ == 0) {
     return 0;
   }
-  double pop_qty = inventory.quantity();
-  cyclus::Material::Ptr fission_matl =
-      inventory.Pop(pop_qty, cyclus::eps_rsrc());
-  inventory.Push(fission_matl);
-  return cyclus::toolkit::UraniumAssayMass(fission_matl);
+  return static_cast<double>(hits_) / (hits_ + misses_);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const EnrichmentCache::Entry& EnrichmentCache::Lookup(double product,
+                                                      double feed,
+                                                      double tails) {
+  AssayKey key;
+  key.product = product;
+  key.feed = feed;
+  key.tails = tails;
+  std::map<AssayKey, Entry>::iterator it = entries_.find(key);
+  if (it != entries_.end()) {
+    hits_++;
+    return it->second;
+  }
+
+  // the feed assay drifts as the inventory is drawn down - don't let stale
+  // entries accumulate forever.
+  if (static_cast<int>(entries_.size()) >= max_size_) {
+    entries_.clear();
+  }
+
+  misses_++;
+  cyclus::toolkit::Assays assays(feed, product, tails);
+  Entry& e = entries_[key];
+  e.swu = cyclus::toolkit::SwuRequired(1, assays);
+  e.feed = cyclus::toolkit::FeedQty(1, assays);
+  return e;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const EnrichmentCache::CompEntry& EnrichmentCache::Lookup(
+    cyclus::Composition::Ptr c) {
+  std::map<int, CompEntry>::iterator it = comps_.find(c->id());
+  if (it != comps_.end()) {
+    return it->second;
+  }
+
+  if (static_cast<int>(comps_.size()) >= max_size_) {
+    comps_.clear();
+  }
+
+  cyclus::Material::Ptr m = cyclus::Material::CreateUntracked(1, c);
+  cyclus::toolkit::MatQuery mq(m);
+  std::set<cyclus::Nuc> nucs;
+  nucs.insert(922350000);
+  nucs.insert(922380000);
+  CompEntry& e = comps_[c->id()];
+  e.assay = cyclus::toolkit::UraniumAssayMass(m);
+  e.ufrac = mq.mass_frac(nucs);
+  return e;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
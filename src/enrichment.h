@@ -1,21 +1,96 @@
 #ifndef CYCAMORE_SRC_ENRICHMENT_H_
 #define CYCAMORE_SRC_ENRICHMENT_H_
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "inventory_footprint.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
+/// Flags describing the non-enrichable content of a feed composition.
+enum FeedFlag {
+  EXTRA_U = 1,  // uranium isotopes other than U-235 and U-238
+  OTHER_ELEM = 2,  // non-uranium elements
+};
+
+/// EnrichmentCache memoizes enrichment math.  SWU and natural uranium
+/// requirements are linear in the product quantity, so they are stored per kg
+/// of product keyed on the (product, feed, tails) assays.  The uranium assay
+/// and uranium mass fraction of materials are also memoized keyed on
+/// composition id.  Large fleets send many requests at only a few distinct
+/// product assays, so a single cache is shared by an Enrichment's exchange
+/// converters and its Enrich_ calculations.
+class EnrichmentCache {
+ public:
+  EnrichmentCache(int max_size = 10000);
+
+  /// @return the SWU required per kg of product
+  double SwuPerKg(double product, double feed, double tails);
+
+  /// @return the U-235 + U-238 feed required per kg of product
+  double FeedPerKg(double product, double feed, double tails);
+
+  /// @return the U-235 mass fraction of the uranium in c
+  double Assay(cyclus::Composition::Ptr c);
+
+  /// @return the mass fraction of c that is U-235 or U-238
+  double UFrac(cyclus::Composition::Ptr c);
+
+  /// Evaluates the SWU and natural uranium conversions of every material in
+  /// mats at once, filling swu and natu with one entry per material.
+  void Convert(const std::vector<cyclus::Material::Ptr>& mats, double feed,
+               double tails, std::vector<double>* swu,
+               std::vector<double>* natu);
+
+  int max_size() const { return max_size_; }
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+  double hit_rate() const;
+
+ private:
+  struct AssayKey {
+    double product;
+    double feed;
+    double tails;
+    bool operator<(const AssayKey& other) const;
+  };
+
+  struct Entry {
+    double swu;
+    double feed;
+  };
+
+  struct CompEntry {
+    double assay;
+    double ufrac;
+  };
+
+  const Entry& Lookup(double product, double feed, double tails);
+  const CompEntry& Lookup(cyclus::Composition::Ptr c);
+
+  int max_size_;
+  int hits_;
+  int misses_;
+  std::map<AssayKey, Entry> entries_;
+  std::map<int, CompEntry> comps_;
+};
+
 /// @class SWUConverter
 ///
 /// @brief The SWUConverter is a simple Converter class for material to
 /// determine the amount of SWU required for their proposed enrichment
 class SWUConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  SWUConverter(double feed_commod, double tails) : feed_(feed_commod),
-    tails_(tails) {}
+  SWUConverter(double feed_commod, double tails,
+               EnrichmentCache* cache = NULL)
+    : feed_(feed_commod), tails_(tails), cache_(cache) {}
   virtual ~SWUConverter() {}
 
   /// @brief provides a conversion for the SWU required
@@ -24,6 +99,10 @@ class SWUConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Arc const * a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material>
           const * ctx = NULL) const {
+    if (cache_ != NULL) {
+      double product = cache_->Assay(m->comp());
+      return m->quantity() * cache_->SwuPerKg(product, feed_, tails_);
+    }
     cyclus::toolkit::Assays assays(feed_, cyclus::toolkit::UraniumAssayMass(m),
                                    tails_);
     return cyclus::toolkit::SwuRequired(m->quantity(), assays);
@@ -39,6 +118,7 @@ class SWUConverter : public cyclus::Converter<cyclus::Material> {
 
  private:
   double feed_, tails_;
+  EnrichmentCache* cache_;
 };
 
 /// @class NatUConverter
@@ -48,8 +128,9 @@ class SWUConverter : public cyclus::Converter<cyclus::Material> {
 /// enrichment
 class NatUConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  NatUConverter(double feed_commod, double tails) : feed_(feed_commod),
-    tails_(tails) {}
+  NatUConverter(double feed_commod, double tails,
+                EnrichmentCache* cache = NULL)
+    : feed_(feed_commod), tails_(tails), cache_(cache) {}
   virtual ~NatUConverter() {}
 
   virtual std::string version() { return CYCAMORE_VERSION; }
@@ -60,6 +141,12 @@ class NatUConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Arc const * a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material>
           const * ctx = NULL) const {
+    if (cache_ != NULL) {
+      cyclus::Composition::Ptr c = m->comp();
+      double product = cache_->Assay(c);
+      return m->quantity() * cache_->FeedPerKg(product, feed_, tails_) /
+             cache_->UFrac(c);
+    }
     cyclus::toolkit::Assays assays(feed_, cyclus::toolkit::UraniumAssayMass(m),
                                    tails_);
     cyclus::toolkit::MatQuery mq(m);
@@ -82,6 +169,7 @@ class NatUConverter : public cyclus::Converter<cyclus::Material> {
 
  private:
   double feed_, tails_;
+  EnrichmentCache* cache_;
 };
 
 ///  The Enrichment facility is a simple Agent that enriches natural
@@ -115,7 +203,7 @@ class NatUConverter : public cyclus::Converter<cyclus::Material> {
 ///  no associated recipe.  Bids for tails are constrained only by total
 ///  tails inventory.
 
-class Enrichment : public cyclus::Facility {
+class Enrichment : public cyclus::Facility, public ConcurrentTimeListener {
 #pragma cyclus note {   	  \
   "niche": "enrichment facility",				  \
   "doc":								\
@@ -245,6 +333,10 @@ class Enrichment : public cyclus::Facility {
   ///   @throws if the material is not the same composition as the feed_recipe
   void AddMat_(cyclus::Material::Ptr mat);
 
+  ///   @brief returns the FeedFlag bits of a feed composition, memoized on
+  ///   composition id
+  int FeedFlags_(cyclus::Composition::Ptr c);
+
   ///   @brief generates a request for this facility given its current state.
   ///   Quantity of the material will be equal to remaining inventory size.
   cyclus::Material::Ptr Request_();
@@ -262,9 +354,44 @@ class Enrichment : public cyclus::Facility {
   ///  @brief calculates the feed assay based on the unenriched inventory
   double FeedAssay();
 
+  ///  @brief the mass fraction of the unenriched inventory that is U-235 or
+  ///  U-238
+  double NatUFrac();
+
+  ///  @brief adds (sign = 1) or removes (sign = -1) the uranium content of a
+  ///  material to the running feed inventory totals
+  void TrackFeed_(cyclus::Material::Ptr mat, double sign);
+
+  ///  @brief recomputes the running feed inventory totals from the inventory
+  ///  if they have drifted from it (e.g. after the inventory was restored
+  ///  from a snapshot)
+  void SyncFeed_();
+
+  ///  @brief merges tails materials with equal uranium assays
+  void CompactTails_();
+
+  ///  @brief adds a feed material to the inventory bin holding feed of the
+  ///  same uranium assay, or as a new bin if there is none
+  void BinFeed_(cyclus::Material::Ptr mat);
+
+  ///  @brief pops the feed for qty of product at the given assay from a
+  ///  single feed bin.  Only bins at least as rich as the blended feed are
+  ///  used, so the trade needs no more SWU or natural uranium than the
+  ///  exchange allowed for; of those the richest bin holding enough feed is
+  ///  chosen.
+  ///  @param feed_assay set to the assay of the chosen bin
+  ///  @param ufrac set to the U-235 + U-238 mass fraction of the chosen bin
+  ///  @return the feed, or a null pointer if no bin can supply it alone
+  cyclus::Material::Ptr PopFeedBin_(double qty, double product,
+                                    double* feed_assay, double* ufrac);
+
   ///  @brief records and enrichment with the cyclus::Recorder
   void RecordEnrichment_(double natural_u, double swu);
 
+  ///  @brief records the current time step's enrichment totals to the
+  ///  EnrichmentTotals table, if any enrichment was made
+  void RecordEnrichmentTotals_();
+
   #pragma cyclus var { \
     "tooltip": "feed commodity",					\
     "doc": "feed commodity that the enrichment facility accepts",	\
@@ -352,6 +479,83 @@ class Enrichment : public cyclus::Facility {
   }
   bool order_prefs;
 
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "Merge tails of equal assay", \
+    "uilabel": "Compact Tails Inventory", \
+    "doc": "If true, tails materials with equal uranium assays are merged " \
+           "into a single material at the end of each time step, keeping " \
+           "the tails inventory small over long simulations." \
+  }
+  bool compact_tails;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "Hold feed in bins by assay", \
+    "uilabel": "Bin Feed Inventory", \
+    "doc": "If true, feed is held as one material per distinct uranium " \
+           "assay and each enrichment draws its feed from a single bin, " \
+           "using that bin's assay, instead of from the front of the feed " \
+           "inventory at its blended assay." \
+  }
+  bool bin_feed;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "Offer one aggregated tails bid per request", \
+    "uilabel": "Aggregate Tails Bids", \
+    "doc": "If true, the tails inventory is offered as a single blended bid " \
+           "per tails request instead of with one bid per tails material." \
+  }
+  bool aggregate_tails_bids;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "Record one Enrichments total per time step", \
+    "uilabel": "Aggregate Enrichment Records", \
+    "doc": "If true, enrichments are recorded to the EnrichmentTotals " \
+           "table as one row per time step with any enrichment, holding the " \
+           "total feed, SWU and product quantity and the number of trades, " \
+           "instead of with one Enrichments row per trade." \
+  }
+  bool aggregate_enrichments;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "Record per-callback timings", \
+    "uilabel": "Record Performance", \
+    "doc": "If true, the wall time of each time step and exchange callback " \
+           "is written to the ArchetypePerf table every time step, along " \
+           "with the number of requests, bids or trades it handled." \
+  }
+  bool record_perf;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "userlevel": 10, \
+    "tooltip": "Time steps between inventory footprints", \
+    "uilabel": "Inventory Footprint Interval", \
+    "doc": "If positive, the number of material objects, total quantity and " \
+           "number of distinct compositions held in the feed inventory and " \
+           "tails are recorded to the InventoryFootprint table every this " \
+           "many time steps." \
+  }
+  int footprint_interval;
+
+  ///  @brief records the inventory footprint if one is due this time step
+  void RecordFootprint_();
+
+  /// per-phase timings for the current time step
+  ArchetypePerf perf_;
+
+  /// resolved feed_recipe
+  RecipeHandle feed_rec_;
+
   #pragma cyclus var {						       \
     "default": 1e299,						       \
     "tooltip": "SWU capacity (kgSWU/month)",			       \
@@ -374,6 +578,20 @@ class Enrichment : public cyclus::Facility {
   // these help enable time series generation.
   double intra_timestep_swu_;
   double intra_timestep_feed_;
+  double intra_timestep_product_;
+  int intra_timestep_trades_;
+
+  // running U-235, U-238 and total masses of the feed inventory so that its
+  // assay can be read without merging the inventory into a single material
+  double feed_u235_;
+  double feed_u238_;
+  double feed_qty_;
+
+  EnrichmentCache enrich_cache_;
+
+  // FeedFlag bits of recently seen feed compositions, keyed on composition
+  // id; cleared once it holds enrich_cache_.max_size() entries
+  std::map<int, int> feed_flags_;
 
   friend class EnrichmentTest;
   // ---
@@ -259,6 +259,48 @@ TEST_F(EnrichmentTest, TradeTails) {
   EXPECT_EQ(1, qr.rows.size());
   
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, AggregateEnrichments) {
+  // this tests that all trades enriched in a time step are recorded as a
+  // single EnrichmentTotals row.
+
+  std::string config =
+    "   <feed_commod>natu</feed_commod> "
+    "   <feed_recipe>natu1</feed_recipe> "
+    "   <product_commod>enr_u</product_commod> "
+    "   <tails_commod>tails</tails_commod> "
+    "   <tails_assay>0.003</tails_assay> "
+    "   <aggregate_enrichments>1</aggregate_enrichments> ";
+
+  // time 0-source to EF, 1-Enrich
+  int simdur = 2;
+  cyclus::MockSim sim(cyclus::AgentSpec
+		      (":cycamore:Enrichment"), config, simdur);
+  sim.AddRecipe("natu1", c_natu1());
+  sim.AddRecipe("leu", c_leu());
+
+  sim.AddSource("natu")
+    .recipe("natu1")
+    .Finalize();
+  for (int i = 0; i < 3; ++i) {
+    sim.AddSink("enr_u")
+      .recipe("leu")
+      .capacity(1.0)
+      .Finalize();
+  }
+
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("ID", "==", id));
+  QueryResult qr = sim.db().Query("EnrichmentTotals", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("Time"));
+  EXPECT_EQ(3, qr.GetVal<int>("NTrades"));
+  EXPECT_NEAR(3.0, qr.GetVal<double>("Product"), 1e-6);
+  EXPECT_LT(0, qr.GetVal<double>("SWU"));
+}
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   TEST_F(EnrichmentTest, TailsQty) {
   // this tests whether tails are being traded at correct quantity when
@@ -518,6 +560,27 @@ EnrichmentTest::DoEnrich(cyclus::Material::Ptr mat, double qty) {
   return src_facility->Enrich_(mat, qty);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentTest::DoFeedAssay() {
+  return src_facility->FeedAssay();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void EnrichmentTest::DoCompactTails() {
+  src_facility->CompactTails_();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void EnrichmentTest::DoBinFeed(bool bin) {
+  src_facility->bin_feed = bin;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const cyclus::toolkit::ResBuf<cyclus::Material>&
+EnrichmentTest::DoInventory() {
+  return src_facility->inventory;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, Request) {
   // Tests that quantity in material request is accurate
@@ -611,6 +674,46 @@ TEST_F(EnrichmentTest, ValidReq) {
   EXPECT_NEAR(natuc.convert(target) * mass_frac, natuc.convert(offer), 0.001); 
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, EnrichmentCache) {
+  using cyclus::Material;
+
+  EnrichmentCache cache;
+  SWUConverter swuc(feed_assay, tails_assay);
+  NatUConverter natuc(feed_assay, tails_assay);
+  SWUConverter cached_swuc(feed_assay, tails_assay, &cache);
+  NatUConverter cached_natuc(feed_assay, tails_assay, &cache);
+  EXPECT_TRUE(swuc == cached_swuc);
+
+  cyclus::CompMap v;
+  v[922350000] = 0.04;
+  v[922380000] = 0.95;
+  v[10070000] = 0.01;
+  cyclus::Composition::Ptr c = cyclus::Composition::CreateFromMass(v);
+  cyclus::toolkit::MatVec mats;
+  mats.push_back(Material::CreateUntracked(2, c));
+  mats.push_back(Material::CreateUntracked(5, c));
+
+  for (int i = 0; i < mats.size(); ++i) {
+    EXPECT_NEAR(swuc.convert(mats[i]), cached_swuc.convert(mats[i]), 1e-9);
+    EXPECT_NEAR(natuc.convert(mats[i]), cached_natuc.convert(mats[i]), 1e-9);
+  }
+  // one miss for the assay entry, every other lookup is a hit
+  EXPECT_EQ(1, cache.misses());
+  EXPECT_EQ(3, cache.hits());
+
+  std::vector<double> swu;
+  std::vector<double> natu;
+  cache.Convert(mats, feed_assay, tails_assay, &swu, &natu);
+  ASSERT_EQ(2, swu.size());
+  ASSERT_EQ(2, natu.size());
+  for (int i = 0; i < mats.size(); ++i) {
+    EXPECT_NEAR(swuc.convert(mats[i]), swu[i], 1e-9);
+    EXPECT_NEAR(natuc.convert(mats[i]), natu[i], 1e-9);
+  }
+  EXPECT_EQ(1, cache.misses());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, Enrich) {
   // this test asks the facility to enrich a material that results in an amount
@@ -660,6 +763,102 @@ TEST_F(EnrichmentTest, Enrich) {
   EXPECT_THROW(response = DoEnrich(target, qty), cyclus::Error);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, FeedAssay) {
+  // the running feed assay must agree with the assay of the merged inventory
+  // as materials of different assays are added and removed
+  using cyclus::Material;
+  using cyclus::toolkit::UraniumAssayMass;
+
+  EXPECT_DOUBLE_EQ(0, DoFeedAssay());
+
+  cyclus::CompMap v;
+  v[922350000] = 0.01;
+  v[922380000] = 0.99;
+  Material::Ptr rich = Material::CreateUntracked(
+      1, cyclus::Composition::CreateFromMass(v));
+
+  DoAddMat(GetMat(3));
+  EXPECT_NEAR(feed_assay, DoFeedAssay(), 1e-12);
+  DoAddMat(rich);
+  double expected = (3 * feed_assay + 1 * 0.01) / 4;
+  EXPECT_NEAR(expected, DoFeedAssay(), 1e-12);
+
+  cyclus::CompMap p;
+  p[922350000] = 0.05;
+  p[922380000] = 0.95;
+  Material::Ptr target = Material::CreateUntracked(
+      0.1, cyclus::Composition::CreateFromMass(p));
+  cyclus::toolkit::Assays assays(expected, 0.05, tails_assay);
+  double feed = cyclus::toolkit::FeedQty(0.1, assays);
+  DoEnrich(target, 0.1);
+  // feed is drawn from the front of the inventory
+  expected = ((3 - feed) * feed_assay + 1 * 0.01) / (4 - feed);
+  EXPECT_NEAR(expected, DoFeedAssay(), 1e-12);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, CompactTails) {
+  // every enrichment leaves behind its own tails material, all at the same
+  // assay - compaction merges them without changing the total
+  using cyclus::Material;
+
+  cyclus::CompMap v;
+  v[922350000] = 0.04;
+  v[922380000] = 0.96;
+  Material::Ptr target = Material::CreateUntracked(
+      0.1, cyclus::Composition::CreateFromMass(v));
+
+  DoAddMat(GetMat(inv_size));
+  DoEnrich(target, 0.1);
+  DoEnrich(target, 0.1);
+  DoEnrich(target, 0.1);
+  ASSERT_EQ(3, src_facility->Tails().count());
+  double qty = src_facility->Tails().quantity();
+
+  DoCompactTails();
+  EXPECT_EQ(1, src_facility->Tails().count());
+  EXPECT_NEAR(qty, src_facility->Tails().quantity(), 1e-10);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, BinFeed) {
+  // feed of equal assays shares a bin, and an enrichment draws its feed from
+  // the richest bin at that bin's assay, leaving the other bin untouched
+  using cyclus::Material;
+
+  DoBinFeed(true);
+  src_facility->SetMaxInventorySize(10);
+
+  cyclus::CompMap v;
+  v[922350000] = 0.01;
+  v[922380000] = 0.99;
+  Material::Ptr rich = Material::CreateUntracked(
+      1, cyclus::Composition::CreateFromMass(v));
+
+  DoAddMat(GetMat(3));
+  DoAddMat(rich);
+  DoAddMat(GetMat(2));
+  ASSERT_EQ(2, DoInventory().count());
+  EXPECT_NEAR(6, DoInventory().quantity(), 1e-12);
+
+  cyclus::CompMap p;
+  p[922350000] = 0.05;
+  p[922380000] = 0.95;
+  Material::Ptr target = Material::CreateUntracked(
+      0.01, cyclus::Composition::CreateFromMass(p));
+  cyclus::toolkit::Assays assays(0.01, 0.05, tails_assay);
+  double feed = cyclus::toolkit::FeedQty(0.01, assays);
+  Material::Ptr response = DoEnrich(target, 0.01);
+
+  EXPECT_NEAR(0.01, response->quantity(), 1e-12);
+  EXPECT_EQ(2, DoInventory().count());
+  EXPECT_NEAR(6 - feed, DoInventory().quantity(), 1e-10);
+  EXPECT_NEAR(feed - 0.01, src_facility->Tails().quantity(), 1e-10);
+  double expected = (5 * feed_assay + (1 - feed) * 0.01) / (6 - feed);
+  EXPECT_NEAR(expected, DoFeedAssay(), 1e-10);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, Response) {
   // this test asks the facility to respond to multiple requests for enriched
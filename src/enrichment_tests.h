@@ -41,6 +41,10 @@ class EnrichmentTest : public ::testing::Test {
   cyclus::Material::Ptr DoBid(cyclus::Material::Ptr mat);
   cyclus::Material::Ptr DoOffer(cyclus::Material::Ptr mat);
   cyclus::Material::Ptr DoEnrich(cyclus::Material::Ptr mat, double qty);
+  double DoFeedAssay();
+  void DoCompactTails();
+  void DoBinFeed(bool bin);
+  const cyclus::toolkit::ResBuf<cyclus::Material>& DoInventory();
   /// @param nreqs the total number of requests
   /// @param nvalid the number of requests that are valid
   boost::shared_ptr< cyclus::ExchangeContext<cyclus::Material> >
@@ -1,5 +1,6 @@
 #include "fuel_fab.h"
 
+#include <mutex>
 #include <sstream>
 
 using cyclus::Material;
@@ -14,13 +15,14 @@ namespace cycamore {
 
 class FissConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  FissConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
-  }
+  FissConverter(const StreamWeights& w, CosiCache* cache)
+      : cache_(cache),
+        w_fiss_(w.fiss),
+        w_topup_(w.topup),
+        w_fill_(w.fill),
+        mm_fiss_(w.mm_fiss),
+        mm_topup_(w.mm_topup),
+        mm_fill_(w.mm_fill) {}
 
   virtual ~FissConverter() {}
 
@@ -28,14 +30,14 @@ class FissConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
+    double w_tgt = cache_->Weight(m->comp());
     if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
       double frac = HighFrac(w_fill_, w_tgt, w_fiss_);
-      return AtomToMassFrac(frac, c_fiss_, c_fill_) * m->quantity();
+      return AtomToMassFrac(frac, mm_fiss_, mm_fill_) * m->quantity();
     } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
       // use fiss inventory as filler, and topup as fissile
       double frac = LowFrac(w_fiss_, w_tgt, w_topup_);
-      return AtomToMassFrac(frac, c_fiss_, c_topup_) * m->quantity();
+      return AtomToMassFrac(frac, mm_fiss_, mm_topup_) * m->quantity();
     } else {
       // don't bid at all
       return 1e200;
@@ -43,24 +45,25 @@ class FissConverter : public cyclus::Converter<cyclus::Material> {
   }
 
  private:
-  std::string spec_;
+  CosiCache* cache_;
   double w_fiss_;
   double w_topup_;
   double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  double mm_fiss_;
+  double mm_topup_;
+  double mm_fill_;
 };
 
 class FillConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  FillConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
-  }
+  FillConverter(const StreamWeights& w, CosiCache* cache)
+      : cache_(cache),
+        w_fiss_(w.fiss),
+        w_topup_(w.topup),
+        w_fill_(w.fill),
+        mm_fiss_(w.mm_fiss),
+        mm_topup_(w.mm_topup),
+        mm_fill_(w.mm_fill) {}
 
   virtual ~FillConverter() {}
 
@@ -68,10 +71,10 @@ class FillConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
+    double w_tgt = cache_->Weight(m->comp());
     if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
       double frac = LowFrac(w_fill_, w_tgt, w_fiss_);
-      return AtomToMassFrac(frac, c_fill_, c_fiss_) * m->quantity();
+      return AtomToMassFrac(frac, mm_fill_, mm_fiss_) * m->quantity();
     } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
       // switched fissile inventory to filler so don't need any filler inventory
       return 0;
@@ -82,24 +85,25 @@ class FillConverter : public cyclus::Converter<cyclus::Material> {
   }
 
  private:
-  std::string spec_;
+  CosiCache* cache_;
   double w_fiss_;
   double w_topup_;
   double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  double mm_fiss_;
+  double mm_topup_;
+  double mm_fill_;
 };
 
 class TopupConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  TopupConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                 Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
-  }
+  TopupConverter(const StreamWeights& w, CosiCache* cache)
+      : cache_(cache),
+        w_fiss_(w.fiss),
+        w_topup_(w.topup),
+        w_fill_(w.fill),
+        mm_fiss_(w.mm_fiss),
+        mm_topup_(w.mm_topup),
+        mm_fill_(w.mm_fill) {}
 
   virtual ~TopupConverter() {}
 
@@ -107,13 +111,13 @@ class TopupConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
+    double w_tgt = cache_->Weight(m->comp());
     if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
       return 0;
     } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
       // switched fissile inventory to filler and topup as fissile
       double frac = HighFrac(w_fiss_, w_tgt, w_topup_);
-      return AtomToMassFrac(frac, c_topup_, c_fiss_) * m->quantity();
+      return AtomToMassFrac(frac, mm_topup_, mm_fiss_) * m->quantity();
     } else {
       // don't bid at all
       return 1e200;
@@ -121,17 +125,22 @@ class TopupConverter : public cyclus::Converter<cyclus::Material> {
   }
 
  private:
-  std::string spec_;
+  CosiCache* cache_;
   double w_fiss_;
   double w_topup_;
   double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  double mm_fiss_;
+  double mm_topup_;
+  double mm_fill_;
 };
 
 FuelFab::FuelFab(cyclus::Context* ctx)
-    : cyclus::Facility(ctx), fill_size(0), fiss_size(0), throughput(0) {}
+    : cyclus::Facility(ctx),
+      fill_size(0),
+      fiss_size(0),
+      throughput(0),
+      record_perf(false),
+      spectrum_type_(THERMAL) {}
 
 void FuelFab::EnterNotify() {
   cyclus::Facility::EnterNotify();
@@ -157,9 +166,38 @@ void FuelFab::EnterNotify() {
        << " fill_commod_prefs vals, expected " << fill_commods.size();
     throw cyclus::ValidationError(ss.str());
   }
+
+  try {
+    spectrum_type_ = SpectrumType(spectrum);
+    cosi_cache_.Reset(spectrum_type_);
+  } catch (cyclus::ValueError err) {
+    std::stringstream ss;
+    ss << "prototype '" << prototype() << "' has invalid spectrum '" << spectrum
+       << "'";
+    throw cyclus::ValidationError(ss.str());
+  }
+
+  // warm the weight table with the configured recipes so the first exchange
+  // doesn't pay for the cross section lookups.
+  cosi_cache_.Weight(fill_rec_.Get(context(), fill_recipe));
+  if (!fiss_recipe.empty()) {
+    cosi_cache_.Weight(fiss_rec_.Get(context(), fiss_recipe));
+  }
+  if (!topup_recipe.empty()) {
+    cosi_cache_.Weight(topup_rec_.Get(context(), topup_recipe));
+  }
+}
+
+void FuelFab::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  LOG(cyclus::LEV_INFO4, "FuelFab") << prototype() << " weight cache: "
+                                    << cosi_cache_.hits() << " hits, "
+                                    << cosi_cache_.misses() << " misses ("
+                                    << 100 * cosi_cache_.hit_rate() << "%)";
 }
 
 std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<Material>::Ptr> ports;
@@ -171,7 +209,7 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
 
     Material::Ptr m = cyclus::NewBlankMaterial(fiss.space());
     if (!fiss_recipe.empty()) {
-      Composition::Ptr c = context()->GetRecipe(fiss_recipe);
+      Composition::Ptr c = fiss_rec_.Get(context(), fiss_recipe);
       m = Material::CreateUntracked(fiss.space(), c);
     }
 
@@ -191,7 +229,7 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
 
     Material::Ptr m = cyclus::NewBlankMaterial(fill.space());
     if (!fill_recipe.empty()) {
-      Composition::Ptr c = context()->GetRecipe(fill_recipe);
+      Composition::Ptr c = fill_rec_.Get(context(), fill_recipe);
       m = Material::CreateUntracked(fill.space(), c);
     }
 
@@ -211,7 +249,7 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
 
     Material::Ptr m = cyclus::NewBlankMaterial(topup.space());
     if (!topup_recipe.empty()) {
-      Composition::Ptr c = context()->GetRecipe(topup_recipe);
+      Composition::Ptr c = topup_rec_.Get(context(), topup_recipe);
       m = Material::CreateUntracked(topup.space(), c);
     }
     cyclus::Request<Material>* r =
@@ -220,6 +258,7 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
     ports.insert(port);
   }
 
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
   return ports;
 }
 
@@ -235,6 +274,8 @@ bool Contains(std::vector<std::string> vec, std::string s) {
 void FuelFab::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -244,11 +285,11 @@ void FuelFab::AcceptMatlTrades(
     cyclus::Request<Material>* req = trade->first.request;
     Material::Ptr m = trade->second;
     if (req_inventories_[req] == "fill") {
-      fill.Push(m);
+      PushMix(&fill, &fill_mix_, m);
     } else if (req_inventories_[req] == "topup") {
-      topup.Push(m);
+      PushMix(&topup, &topup_mix_, m);
     } else if (req_inventories_[req] == "fiss") {
-      fiss.Push(m);
+      PushMix(&fiss, &fiss_mix_, m);
     } else {
       throw cyclus::ValueError("cycamore::FuelFab was overmatched on requests");
     }
@@ -256,21 +297,14 @@ void FuelFab::AcceptMatlTrades(
 
   req_inventories_.clear();
 
-  // IMPORTANT - each buffer needs to be a single homogenous composition or
-  // the inventory mixing constraints for bids don't work
-  if (fill.count() > 1) {
-    fill.Push(cyclus::toolkit::Squash(fill.PopN(fill.count())));
-  }
-  if (fiss.count() > 1) {
-    fiss.Push(cyclus::toolkit::Squash(fiss.PopN(fiss.count())));
-  }
-  if (topup.count() > 1) {
-    topup.Push(cyclus::toolkit::Squash(topup.PopN(topup.count())));
-  }
+  // IMPORTANT - each buffer is treated as a single homogenous composition by
+  // the inventory mixing constraints for bids.  Its running mix gives that
+  // composition's weight, and the buffer is only merged when it is popped.
 }
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
   using cyclus::BidPortfolio;
 
   std::set<BidPortfolio<Material>::Ptr> ports;
@@ -282,90 +316,121 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
     return ports;
   }
 
+  // buffered streams use the weights and compositions of their running
+  // mixes, which are what the merged buffers will supply
   double w_fill = 0;
+  double mm_fill = 0;
   Composition::Ptr
       c_fill;  // no default needed - this is non-optional parameter
   if (fill.count() > 0) {
-    c_fill = fill.Peek()->comp();
-    w_fill = CosiWeight(c_fill, spectrum);
+    const StreamMix& mix = SyncMix(&fill, &fill_mix_);
+    c_fill = mix.comp();
+    w_fill = mix.weight();
+    mm_fill = mix.molar_mass();
   } else {
-    c_fill = context()->GetRecipe(fill_recipe);
-    w_fill = CosiWeight(c_fill, spectrum);
+    c_fill = fill_rec_.Get(context(), fill_recipe);
+    w_fill = cosi_cache_.Weight(c_fill);
+    mm_fill = cosi_cache_.MolarMass(c_fill);
   }
 
   double w_topup = 0;
+  double mm_topup = mm_fill;
   Composition::Ptr c_topup = c_fill;
   if (topup.count() > 0) {
-    c_topup = topup.Peek()->comp();
-    w_topup = CosiWeight(c_topup, spectrum);
+    const StreamMix& mix = SyncMix(&topup, &topup_mix_);
+    c_topup = mix.comp();
+    w_topup = mix.weight();
+    mm_topup = mix.molar_mass();
   } else if (!topup_recipe.empty()) {
-    c_topup = context()->GetRecipe(topup_recipe);
-    w_topup = CosiWeight(c_topup, spectrum);
+    c_topup = topup_rec_.Get(context(), topup_recipe);
+    w_topup = cosi_cache_.Weight(c_topup);
+    mm_topup = cosi_cache_.MolarMass(c_topup);
   }
 
   double w_fiss =
       w_fill;  // this allows trading just fill with no fiss inventory
+  double mm_fiss = mm_fill;
   Composition::Ptr c_fiss = c_fill;
   if (fiss.count() > 0) {
-    c_fiss = fiss.Peek()->comp();
-    w_fiss = CosiWeight(c_fiss, spectrum);
+    const StreamMix& mix = SyncMix(&fiss, &fiss_mix_);
+    c_fiss = mix.comp();
+    w_fiss = mix.weight();
+    mm_fiss = mix.molar_mass();
   } else if (!fiss_recipe.empty()) {
-    c_fiss = context()->GetRecipe(fiss_recipe);
-    w_fiss = CosiWeight(c_fiss, spectrum);
+    c_fiss = fiss_rec_.Get(context(), fiss_recipe);
+    w_fiss = cosi_cache_.Weight(c_fiss);
+    mm_fiss = cosi_cache_.MolarMass(c_fiss);
   }
 
+  // reactors of one design all request the same recipe, so the mixing
+  // solution is found once per distinct target composition (NULL if the
+  // streams can't meet it) and one offer is shared by equal sized requests
+  std::map<int, Composition::Ptr> mixes;
+  std::map<std::pair<int, double>, Material::Ptr> offers;
+
   BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
   for (int j = 0; j < reqs.size(); j++) {
     cyclus::Request<Material>* req = reqs[j];
 
     Composition::Ptr tgt = req->target()->comp();
-    double w_tgt = CosiWeight(tgt, spectrum);
     double tgt_qty = req->target()->quantity();
-    if (ValidWeights(w_fill, w_tgt, w_fiss)) {
-      double fiss_frac = HighFrac(w_fill, w_tgt, w_fiss);
-      double fill_frac = 1 - fiss_frac;
-      fiss_frac = AtomToMassFrac(fiss_frac, c_fiss, c_fill);
-      fill_frac = AtomToMassFrac(fill_frac, c_fill, c_fiss);
-      Material::Ptr m1 = Material::CreateUntracked(fiss_frac * tgt_qty, c_fiss);
-      Material::Ptr m2 = Material::CreateUntracked(fill_frac * tgt_qty, c_fill);
-      m1->Absorb(m2);
-
-      bool exclusive = false;
-      port->AddBid(req, m1, this, exclusive);
-    } else if (topup.count() > 0 && ValidWeights(w_fiss, w_tgt, w_topup)) {
-      // only bid with topup if we have filler - otherwise we might be able to
-      // meet target with filler when we get it. we should only use topup
-      // when the fissile has too poor neutronics.
-      double topup_frac = HighFrac(w_fiss, w_tgt, w_topup);
-      double fiss_frac = 1 - topup_frac;
-      fiss_frac = AtomToMassFrac(fiss_frac, c_fiss, c_topup);
-      topup_frac = AtomToMassFrac(topup_frac, c_topup, c_fiss);
-      Material::Ptr m1 =
-          Material::CreateUntracked(topup_frac * tgt_qty, c_topup);
-      Material::Ptr m2 = Material::CreateUntracked(fiss_frac * tgt_qty, c_fiss);
-      m1->Absorb(m2);
-
-      bool exclusive = false;
-      port->AddBid(req, m1, this, exclusive);
-    } else if (fiss.count() > 0 && fill.count() > 0 ||
-               fiss.count() > 0 && topup.count() > 0) {
-      // else can't meet the target weight - don't bid.  Just a plain else
-      // doesn't work because we set w_fiss = w_fill if we don't have any fiss
-      // or fill inventory.
-      std::stringstream ss;
-      ss << "prototype '" << prototype()
-         << "': Input stream weights/reactivity do not span "
-            "the requested material weight.";
-      cyclus::Warn<cyclus::VALUE_WARNING>(ss.str());
+    std::map<int, Composition::Ptr>::iterator mix = mixes.find(tgt->id());
+    if (mix == mixes.end()) {
+      Composition::Ptr c;
+      double w_tgt = cosi_cache_.Weight(tgt);
+      if (ValidWeights(w_fill, w_tgt, w_fiss)) {
+        double fiss_frac = HighFrac(w_fill, w_tgt, w_fiss);
+        double fill_frac = 1 - fiss_frac;
+        fiss_frac = AtomToMassFrac(fiss_frac, mm_fiss, mm_fill);
+        fill_frac = AtomToMassFrac(fill_frac, mm_fill, mm_fiss);
+        Material::Ptr m1 = Material::CreateUntracked(fiss_frac, c_fiss);
+        Material::Ptr m2 = Material::CreateUntracked(fill_frac, c_fill);
+        m1->Absorb(m2);
+        c = m1->comp();
+      } else if (topup.count() > 0 && ValidWeights(w_fiss, w_tgt, w_topup)) {
+        // only bid with topup if we have filler - otherwise we might be able
+        // to meet target with filler when we get it. we should only use topup
+        // when the fissile has too poor neutronics.
+        double topup_frac = HighFrac(w_fiss, w_tgt, w_topup);
+        double fiss_frac = 1 - topup_frac;
+        fiss_frac = AtomToMassFrac(fiss_frac, mm_fiss, mm_topup);
+        topup_frac = AtomToMassFrac(topup_frac, mm_topup, mm_fiss);
+        Material::Ptr m1 = Material::CreateUntracked(topup_frac, c_topup);
+        Material::Ptr m2 = Material::CreateUntracked(fiss_frac, c_fiss);
+        m1->Absorb(m2);
+        c = m1->comp();
+      } else if (fiss.count() > 0 && fill.count() > 0 ||
+                 fiss.count() > 0 && topup.count() > 0) {
+        // else can't meet the target weight - don't bid.  Just a plain else
+        // doesn't work because we set w_fiss = w_fill if we don't have any
+        // fiss or fill inventory.
+        std::stringstream ss;
+        ss << "prototype '" << prototype()
+           << "': Input stream weights/reactivity do not span "
+              "the requested material weight.";
+        cyclus::Warn<cyclus::VALUE_WARNING>(ss.str());
+      }
+      mix = mixes.insert(std::make_pair(tgt->id(), c)).first;
+    }
+    if (mix->second.get() == NULL) {
+      continue;
+    }
+
+    Material::Ptr& offer = offers[std::make_pair(tgt->id(), tgt_qty)];
+    if (offer.get() == NULL) {
+      offer = Material::CreateUntracked(tgt_qty, mix->second);
     }
+    bool exclusive = false;
+    port->AddBid(req, offer, this, exclusive);
   }
 
+  StreamWeights w = {w_fill, w_fiss, w_topup, mm_fill, mm_fiss, mm_topup};
   cyclus::Converter<Material>::Ptr fissconv(
-      new FissConverter(c_fill, c_fiss, c_topup, spectrum));
+      new FissConverter(w, &cosi_cache_));
   cyclus::Converter<Material>::Ptr fillconv(
-      new FillConverter(c_fill, c_fiss, c_topup, spectrum));
+      new FillConverter(w, &cosi_cache_));
   cyclus::Converter<Material>::Ptr topupconv(
-      new TopupConverter(c_fill, c_fiss, c_topup, spectrum));
+      new TopupConverter(w, &cosi_cache_));
   // important! - the std::max calls prevent CapacityConstraint throwing a zero
   // cap exception
   cyclus::CapacityConstraint<Material> fissc(std::max(fiss.quantity(), 1e-10),
@@ -381,6 +446,7 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
   cyclus::CapacityConstraint<Material> cc(throughput);
   port->AddConstraint(cc);
   ports.insert(port);
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
   return ports;
 }
 
@@ -388,21 +454,35 @@ void FuelFab::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
   using cyclus::Trade;
 
   // guard against cases where a buffer is empty - this is okay because some 
   // trades may not need that particular buffer.
   double w_fill = 0;
+  double mm_fill = 0;
   if (fill.count() > 0) {
-    w_fill = CosiWeight(fill.Peek()->comp(), spectrum);
+    const StreamMix& mix = SyncMix(&fill, &fill_mix_);
+    w_fill = mix.weight();
+    mm_fill = mix.molar_mass();
+    MergeBuf(&fill);
   }
   double w_topup = 0;
+  double mm_topup = 0;
   if (topup.count() > 0) {
-    w_topup = CosiWeight(topup.Peek()->comp(), spectrum);
+    const StreamMix& mix = SyncMix(&topup, &topup_mix_);
+    w_topup = mix.weight();
+    mm_topup = mix.molar_mass();
+    MergeBuf(&topup);
   }
   double w_fiss = 0;
+  double mm_fiss = 0;
   if (fiss.count() > 0) {
-    w_fiss = CosiWeight(fiss.Peek()->comp(), spectrum);
+    const StreamMix& mix = SyncMix(&fiss, &fiss_mix_);
+    w_fiss = mix.weight();
+    mm_fiss = mix.molar_mass();
+    MergeBuf(&fiss);
   }
 
   std::vector<cyclus::Trade<cyclus::Material> >::const_iterator it;
@@ -410,7 +490,7 @@ void FuelFab::GetMatlTrades(
   for (int i = 0; i < trades.size(); i++) {
     Material::Ptr tgt = trades[i].request->target();
 
-    double w_tgt = CosiWeight(tgt->comp(), spectrum);
+    double w_tgt = cosi_cache_.Weight(tgt->comp());
     double qty = trades[i].amt;
     double wfiss = w_fiss;
 
@@ -441,10 +521,8 @@ void FuelFab::GetMatlTrades(
     } else if (ValidWeights(w_fill, w_tgt, w_fiss)) {
       double fiss_frac = HighFrac(w_fill, w_tgt, w_fiss);
       double fill_frac = LowFrac(w_fill, w_tgt, w_fiss);
-      fiss_frac =
-          AtomToMassFrac(fiss_frac, fiss.Peek()->comp(), fill.Peek()->comp());
-      fill_frac =
-          AtomToMassFrac(fill_frac, fill.Peek()->comp(), fiss.Peek()->comp());
+      fiss_frac = AtomToMassFrac(fiss_frac, mm_fiss, mm_fill);
+      fill_frac = AtomToMassFrac(fill_frac, mm_fill, mm_fiss);
 
       double fissqty = fiss_frac * qty;
       if (std::abs(fissqty - fiss.quantity()) < cyclus::eps_rsrc()) {
@@ -464,10 +542,8 @@ void FuelFab::GetMatlTrades(
     } else {
       double topup_frac = HighFrac(w_fiss, w_tgt, w_topup);
       double fiss_frac = 1 - topup_frac;
-      topup_frac =
-          AtomToMassFrac(topup_frac, topup.Peek()->comp(), fiss.Peek()->comp());
-      fiss_frac =
-          AtomToMassFrac(fiss_frac, fiss.Peek()->comp(), topup.Peek()->comp());
+      topup_frac = AtomToMassFrac(topup_frac, mm_topup, mm_fiss);
+      fiss_frac = AtomToMassFrac(fiss_frac, mm_fiss, mm_topup);
 
       double fissqty = fiss_frac * qty;
       if (std::abs(fissqty - fiss.quantity()) < cyclus::eps_rsrc()) {
@@ -486,12 +562,181 @@ void FuelFab::GetMatlTrades(
       responses.push_back(std::make_pair(trades[i], m));
     }
   }
+
+  // popping takes an even share of each merged buffer
+  fill_mix_.Scale(fill.quantity());
+  fiss_mix_.Scale(fiss.quantity());
+  topup_mix_.Scale(topup.quantity());
+}
+
+const StreamMix& FuelFab::SyncMix(cyclus::toolkit::ResBuf<Material>* buf,
+                                  StreamMix* mix) {
+  if (std::abs(mix->qty - buf->quantity()) <= cyclus::eps_rsrc()) {
+    return *mix;
+  }
+
+  *mix = StreamMix();
+  cyclus::toolkit::MatVec mats = buf->PopN(buf->count());
+  buf->Push(mats);
+  for (int i = 0; i < mats.size(); i++) {
+    Composition::Ptr c = mats[i]->comp();
+    mix->Add(mats[i]->quantity(), c, cosi_cache_.Weight(c),
+             cosi_cache_.MolarMass(c));
+  }
+  return *mix;
+}
+
+void FuelFab::PushMix(cyclus::toolkit::ResBuf<Material>* buf, StreamMix* mix,
+                      Material::Ptr m) {
+  SyncMix(buf, mix);
+  buf->Push(m);
+  Composition::Ptr c = m->comp();
+  mix->Add(m->quantity(), c, cosi_cache_.Weight(c), cosi_cache_.MolarMass(c));
+}
+
+void FuelFab::MergeBuf(cyclus::toolkit::ResBuf<Material>* buf) {
+  if (buf->count() > 1) {
+    buf->Push(cyclus::toolkit::Squash(buf->PopN(buf->count())));
+  }
 }
 
 extern "C" cyclus::Agent* ConstructFuelFab(cyclus::Context* ctx) {
   return new FuelFab(ctx);
 }
 
+const char* SpectrumName(CosiSpectrum spectrum) {
+  switch (spectrum) {
+    case THERMAL:
+      return "thermal";
+    case THERMAL_MAXWELL_AVE:
+      return "thermal_maxwell_ave";
+    case FISSION_SPECTRUM_AVE:
+      return "fission_spectrum_ave";
+    case RESONANCE_INTEGRAL:
+      return "resonance_integral";
+    case FOURTEEN_MEV:
+      return "fourteen_MeV";
+    default:
+      throw cyclus::ValueError("invalid cross section spectrum");
+  }
+}
+
+CosiSpectrum SpectrumType(const std::string& spectrum) {
+  for (int i = 0; i < N_SPECTRA; i++) {
+    if (spectrum == SpectrumName(static_cast<CosiSpectrum>(i))) {
+      return static_cast<CosiSpectrum>(i);
+    }
+  }
+  throw cyclus::ValueError("unsupported cross section spectrum '" + spectrum +
+                           "'");
+}
+
+// Per-spectrum table of single nuclide weights "(p_i - p_U238) / (p_Pu239 -
+// p_U238)".  Ground state nuclides are stored densely, indexed by Z and A;
+// metastable nuclides are rare in fuel compositions and are kept in a sparse
+// map instead.  Entries are filled from PyNE the first time a nuclide is seen.
+class CosiWeightTable {
+ public:
+  CosiWeightTable(CosiSpectrum spectrum)
+      : spec_(SpectrumName(spectrum)),
+        weights_(kMaxZ * kMaxA, 0),
+        known_(kMaxZ * kMaxA, false) {
+    if (spectrum == THERMAL) {
+      nu_pu239_ = 2.85;
+      nu_u233_ = 2.5;
+      nu_u235_ = 2.43;
+    } else {
+      nu_pu239_ = 3.1;
+      nu_u233_ = 2.63;
+      nu_u235_ = 2.58;
+    }
+    p_u238_ = P(922380000);
+    p_pu239_ = P(942390000);
+  }
+
+  double NucWeight(cyclus::Nuc nuc) {
+    int i = Index(nuc);
+    if (i < 0) {
+      std::map<cyclus::Nuc, double>::iterator it = sparse_.find(nuc);
+      if (it != sparse_.end()) {
+        return it->second;
+      }
+      double w = (P(nuc) - p_u238_) / (p_pu239_ - p_u238_);
+      sparse_[nuc] = w;
+      return w;
+    }
+
+    if (!known_[i]) {
+      weights_[i] = (P(nuc) - p_u238_) / (p_pu239_ - p_u238_);
+      known_[i] = true;
+    }
+    return weights_[i];
+  }
+
+  // Atom fractions are normalized on the fly so the composition's CompMap
+  // never needs to be copied.
+  double Weight(Composition::Ptr c) {
+    const cyclus::CompMap& cm = c->atom();
+    cyclus::CompMap::const_iterator it;
+    double tot = 0;
+    double w = 0;
+    for (it = cm.begin(); it != cm.end(); ++it) {
+      tot += it->second;
+      w += it->second * NucWeight(it->first);
+    }
+    if (tot == 0) {
+      return 0;
+    }
+    return w / tot;
+  }
+
+ private:
+  static const int kMaxZ = 119;
+  static const int kMaxA = 300;
+
+  static int Index(cyclus::Nuc nuc) {
+    int z = nuc / 10000000;
+    int a = (nuc / 10000) % 1000;
+    if (nuc % 10000 != 0 || z < 0 || z >= kMaxZ || a >= kMaxA) {
+      return -1;
+    }
+    return z * kMaxA + a;
+  }
+
+  // p = nu*sigma_f - sigma_a
+  double P(cyclus::Nuc nuc) {
+    double nu = 0;
+    if (nuc == 922350000) {
+      nu = nu_u235_;
+    } else if (nuc == 922330000) {
+      nu = nu_u233_;
+    } else if (nuc == 942390000 || nuc == 942410000) {
+      nu = nu_pu239_;
+    }
+
+    double fiss = 0;
+    double absorb = 0;
+    try {
+      fiss = simple_xs(nuc, "fission", spec_);
+      absorb = simple_xs(nuc, "absorption", spec_);
+    } catch (pyne::InvalidSimpleXS err) {
+      fiss = 0;
+      absorb = 0;
+    }
+    return nu * fiss - absorb;
+  }
+
+  std::string spec_;
+  double nu_pu239_;
+  double nu_u233_;
+  double nu_u235_;
+  double p_u238_;
+  double p_pu239_;
+  std::vector<double> weights_;
+  std::vector<bool> known_;
+  std::map<cyclus::Nuc, double> sparse_;
+};
+
 // Returns the weight of c using 1 group cross sections of type spectrum
 // which must be one of:
 //
@@ -506,195 +751,94 @@ extern "C" cyclus::Agent* ConstructFuelFab(cyclus::Context* ctx) {
 // material/mixing fractions will also be atom-based naturally and will need
 // to be converted to mass-based for actual material object mixing.
 double CosiWeight(cyclus::Composition::Ptr c, const std::string& spectrum) {
-  cyclus::CompMap cm = c->atom();
-  cyclus::compmath::Normalize(&cm);
-
-  if (spectrum == "thermal") {
-    double nu_pu239 = 2.85;
-    double nu_u233 = 2.5;
-    double nu_u235 = 2.43;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
-
-    static std::map<int, double> absorb_xs;
-    static std::map<int, double> fiss_xs;
-    static double p_u238 = 0;
-    static double p_pu239 = 0;
-    if (p_u238 == 0) {
-      double fiss_u238 = simple_xs(922380000, "fission", "thermal");
-      double absorb_u238 = simple_xs(922380000, "absorption", "thermal");
-      p_u238 = nu_u238 * fiss_u238 - absorb_u238;
-
-      double fiss_pu239 = simple_xs(942390000, "fission", "thermal");
-      double absorb_pu239 = simple_xs(942390000, "absorption", "thermal");
-      p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
-    }
-
-    cyclus::CompMap::iterator it;
-    double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
-
-      double fiss = 0;
-      double absorb = 0;
-      if (absorb_xs.count(nuc) == 0) {
-        try {
-          fiss = simple_xs(nuc, "fission", "thermal");
-          absorb = simple_xs(nuc, "absorption", "thermal");
-          absorb_xs[nuc] = absorb;
-          fiss_xs[nuc] = fiss;
-        } catch (pyne::InvalidSimpleXS err) {
-          fiss = 0;
-          absorb = 0;
-        }
-      } else {
-        fiss = fiss_xs[nuc];
-        absorb = absorb_xs[nuc];
-      }
+  return CosiWeight(c, SpectrumType(spectrum));
+}
 
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
-    }
-    return w;
-  } else if (spectrum == "fission_spectrum_ave") {
-    double nu_pu239 = 3.1;
-    double nu_u233 = 2.63;
-    double nu_u235 = 2.58;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
-
-    static std::map<int, double> absorb_xs;
-    static std::map<int, double> fiss_xs;
-    static double p_u238 = 0;
-    static double p_pu239 = 0;
-    if (p_u238 == 0) {
-      double fiss_u238 =
-          simple_xs(922380000, "fission", "fission_spectrum_ave");
-      double absorb_u238 =
-          simple_xs(922380000, "absorption", "fission_spectrum_ave");
-      p_u238 = nu_u238 * fiss_u238 - absorb_u238;
-
-      double fiss_pu239 =
-          simple_xs(942390000, "fission", "fission_spectrum_ave");
-      double absorb_pu239 =
-          simple_xs(942390000, "absorption", "fission_spectrum_ave");
-      p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
-    }
+double CosiWeight(cyclus::Composition::Ptr c, CosiSpectrum spectrum) {
+  // the tables are shared by every agent and filled in lazily, so lookups
+  // are serialized to keep concurrently running agents safe.
+  static std::mutex mu;
+  static std::vector<CosiWeightTable*> tables(N_SPECTRA, NULL);
+  std::lock_guard<std::mutex> lock(mu);
+  CosiWeightTable*& t = tables.at(spectrum);
+  if (t == NULL) {
+    t = new CosiWeightTable(spectrum);
+  }
+  return t->Weight(c);
+}
 
-    cyclus::CompMap::iterator it;
-    double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
+double MolarMass(Composition::Ptr c) {
+  const cyclus::CompMap& cm = c->atom();
+  cyclus::CompMap::const_iterator it;
+  double tot = 0;
+  double mass = 0;
+  for (it = cm.begin(); it != cm.end(); ++it) {
+    tot += it->second;
+    mass += it->second * pyne::atomic_mass(it->first);
+  }
+  if (tot == 0) {
+    return 0;
+  }
+  return mass / tot;
+}
 
-      double fiss = 0;
-      double absorb = 0;
-      if (absorb_xs.count(nuc) == 0) {
-        try {
-          fiss = simple_xs(nuc, "fission", "fission_spectrum_ave");
-          absorb = simple_xs(nuc, "absorption", "fission_spectrum_ave");
-          absorb_xs[nuc] = absorb;
-          fiss_xs[nuc] = fiss;
-        } catch (pyne::InvalidSimpleXS err) {
-          fiss = 0;
-          absorb = 0;
-        }
-      } else {
-        fiss = fiss_xs[nuc];
-        absorb = absorb_xs[nuc];
-      }
+CosiCache::CosiCache(CosiSpectrum spectrum, int max_size)
+    : spectrum_(spectrum), max_size_(max_size), hits_(0), misses_(0) {}
 
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
-    }
-    return w;
-  } else {
-    double nu_pu239 = 3.1;
-    double nu_u233 = 2.63;
-    double nu_u235 = 2.58;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
+void CosiCache::Reset(CosiSpectrum spectrum) {
+  if (spectrum != spectrum_) {
+    entries_.clear();
+  }
+  spectrum_ = spectrum;
+}
 
-    double fiss_u238 = simple_xs(922380000, "fission", spectrum);
-    double absorb_u238 = simple_xs(922380000, "absorption", spectrum);
-    double p_u238 = nu_u238 * fiss_u238 - absorb_u238;
+double CosiCache::Weight(Composition::Ptr c) {
+  return Lookup(c).weight;
+}
 
-    double fiss_pu239 = simple_xs(942390000, "fission", spectrum);
-    double absorb_pu239 = simple_xs(942390000, "absorption", spectrum);
-    double p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
+double CosiCache::MolarMass(Composition::Ptr c) {
+  return Lookup(c).molar_mass;
+}
 
-    cyclus::CompMap::iterator it;
-    double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
+double CosiCache::hit_rate() const {
+  if (hits_ + misses_ == 0) {
+    return 0;
+  }
+  return static_cast<double>(hits_) / (hits_ + misses_);
+}
 
-      double fiss = 0;
-      double absorb = 0;
-      try {
-        fiss = simple_xs(nuc, "fission", spectrum);
-        absorb = simple_xs(nuc, "absorption", spectrum);
-      } catch (pyne::InvalidSimpleXS err) {
-        fiss = 0;
-        absorb = 0;
-      }
+const CosiCache::Entry& CosiCache::Lookup(Composition::Ptr c) {
+  std::map<int, Entry>::iterator it = entries_.find(c->id());
+  if (it != entries_.end()) {
+    hits_++;
+    return it->second;
+  }
 
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
-    }
-    return w;
+  // mixed offers create new compositions every time step - don't let them
+  // accumulate forever.
+  if (static_cast<int>(entries_.size()) >= max_size_) {
+    entries_.clear();
   }
+
+  misses_++;
+  Entry& e = entries_[c->id()];
+  e.weight = CosiWeight(c, spectrum_);
+  e.molar_mass = cycamore::MolarMass(c);
+  return e;
 }
 
 // Convert an atom frac (n1/(n1+n2) to a mass frac (m1/(m1+m2) given
 // corresponding compositions c1 and c2.
 double AtomToMassFrac(double atomfrac, Composition::Ptr c1,
                       Composition::Ptr c2) {
-  cyclus::CompMap n1 = c1->atom();
-  cyclus::CompMap n2 = c2->atom();
-  cyclus::compmath::Normalize(&n1, atomfrac);
-  cyclus::compmath::Normalize(&n2, 1 - atomfrac);
-
-  cyclus::CompMap::iterator it;
-
-  double mass1 = 0;
-  for (it = n1.begin(); it != n1.end(); ++it) {
-    mass1 += it->second * pyne::atomic_mass(it->first);
-  }
-
-  double mass2 = 0;
-  for (it = n2.begin(); it != n2.end(); ++it) {
-    mass2 += it->second * pyne::atomic_mass(it->first);
-  }
+  return AtomToMassFrac(atomfrac, MolarMass(c1), MolarMass(c2));
+}
 
+// Same as above, but given the mean molar masses (see MolarMass) of the two
+// compositions rather than the compositions themselves.
+double AtomToMassFrac(double atomfrac, double molar_mass1, double molar_mass2) {
+  double mass1 = atomfrac * molar_mass1;
+  double mass2 = (1 - atomfrac) * molar_mass2;
   return mass1 / (mass1 + mass2);
 }
 
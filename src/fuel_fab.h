@@ -4,9 +4,125 @@
 #include <string>
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
+/// The one group cross section spectra supported by CosiWeight.  These
+/// correspond to the energy group names of PyNE's simple_xs library.
+enum CosiSpectrum {
+  THERMAL = 0,
+  THERMAL_MAXWELL_AVE,
+  FISSION_SPECTRUM_AVE,
+  RESONANCE_INTEGRAL,
+  FOURTEEN_MEV,
+  N_SPECTRA,
+};
+
+/// CosiCache memoizes composition weights (see CosiWeight) and mean molar
+/// masses keyed on composition id.  Compositions are immutable, so entries
+/// only need to be dropped when the spectrum changes.  A single cache is
+/// shared by a FuelFab's bid/trade logic and its exchange converters.
+class CosiCache {
+ public:
+  CosiCache(CosiSpectrum spectrum = THERMAL, int max_size = 10000);
+
+  /// Sets the spectrum used for weights, clearing the cache if it changed.
+  void Reset(CosiSpectrum spectrum);
+
+  double Weight(cyclus::Composition::Ptr c);
+  double MolarMass(cyclus::Composition::Ptr c);
+
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+  double hit_rate() const;
+
+ private:
+  struct Entry {
+    double weight;
+    double molar_mass;
+  };
+
+  const Entry& Lookup(cyclus::Composition::Ptr c);
+
+  CosiSpectrum spectrum_;
+  int max_size_;
+  int hits_;
+  int misses_;
+  std::map<int, Entry> entries_;
+};
+
+/// StreamMix keeps running totals for one FuelFab input buffer so the weight
+/// (see CosiWeight), mean molar mass and composition of its contents, taken
+/// as a single mixed material, are known without merging the materials.  The
+/// weight and molar mass are atom averages, so they follow from the moles and
+/// weighted moles pushed; the composition follows from the nuclide masses.
+struct StreamMix {
+  StreamMix() : qty(0), moles(0), wmoles(0) {}
+
+  /// adds q kg of composition c with weight w and molar mass mm
+  void Add(double q, cyclus::Composition::Ptr c, double w, double mm) {
+    qty += q;
+    if (mm > 0) {
+      moles += q / mm;
+      wmoles += q / mm * w;
+    }
+    cyclus::CompMap v = c->mass();
+    cyclus::compmath::Normalize(&v, q);
+    mass = cyclus::compmath::Add(mass, v);
+    comp_.reset();
+  }
+
+  /// scales the totals to q kg of the same mix, e.g. after a pop
+  void Scale(double q) {
+    double f = qty > 0 ? q / qty : 0;
+    qty = q;
+    moles *= f;
+    wmoles *= f;
+    if (f > 0) {
+      cyclus::compmath::Normalize(&mass, q);
+    } else {
+      mass.clear();
+      comp_.reset();
+    }
+  }
+
+  double weight() const { return moles > 0 ? wmoles / moles : 0; }
+  double molar_mass() const { return moles > 0 ? qty / moles : 0; }
+
+  /// the composition of the mix, or NULL if nothing has been added
+  cyclus::Composition::Ptr comp() const {
+    if (comp_.get() == NULL && !mass.empty()) {
+      comp_ = cyclus::Composition::CreateFromMass(mass);
+    }
+    return comp_;
+  }
+
+  double qty;
+  double moles;
+  double wmoles;
+
+  /// nuclide masses of the mix in kg
+  cyclus::CompMap mass;
+
+ private:
+  // built on first use after each change to the mix
+  mutable cyclus::Composition::Ptr comp_;
+};
+
+/// The weights and molar masses of a FuelFab's three input streams used for
+/// one exchange.
+struct StreamWeights {
+  double fill;
+  double fiss;
+  double topup;
+  double mm_fill;
+  double mm_fiss;
+  double mm_topup;
+};
+
 /// FuelFab takes in 2 streams of material and mixes them in ratios in order to
 /// supply material that matches some neutronics properties of reqeusted
 /// material.  It uses an equivalence type method [1]
@@ -14,8 +130,9 @@ namespace cycamore {
 ///
 /// The FuelFab has 3 input inventories: fissile stream, filler stream, and an
 /// optional top-up inventory.  All materials received into each inventory are
-/// always combined into a single material (i.e. a single fissile material, a
-/// single filler material, etc.).  The input streams and requested fuel
+/// always treated as a single mixed material (i.e. a single fissile material,
+/// a single filler material, etc.) and are merged into one before any is
+/// supplied.  The input streams and requested fuel
 /// composition are each assigned weights based on summing:
 ///
 ///     N * (p_i - p_U238) / (p_Pu239 - p_U238)
@@ -53,7 +170,7 @@ namespace cycamore {
 ///     uranium isotopes in fast reactors." Proceedings of the Conference on
 ///     Breeding. Economics, and Safety in Large Fast Power Reactors. 1963.
 /// @endcode
-class FuelFab : public cyclus::Facility {
+class FuelFab : public cyclus::Facility, public ConcurrentTimeListener {
 #pragma cyclus note { \
 "niche": "fabrication", \
 "doc": \
@@ -112,7 +229,7 @@ class FuelFab : public cyclus::Facility {
 #pragma cyclus
 
   virtual void Tick(){};
-  virtual void Tock(){};
+  virtual void Tock();
   virtual void EnterNotify();
 
   virtual std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> GetMatlBids(
@@ -130,6 +247,21 @@ class FuelFab : public cyclus::Facility {
   GetMatlRequests();
 
  private:
+  /// Returns the running mix of buf, rebuilt from the buffer's contents if
+  /// it no longer matches them.
+  const StreamMix& SyncMix(cyclus::toolkit::ResBuf<cyclus::Material>* buf,
+                           StreamMix* mix);
+
+  /// Pushes m into buf and adds it to the buffer's running mix.
+  void PushMix(cyclus::toolkit::ResBuf<cyclus::Material>* buf, StreamMix* mix,
+               cyclus::Material::Ptr m);
+
+  /// Merges buf into a single material so that what is popped from it has
+  /// the composition of its running mix.  This still absorbs every material
+  /// received since the last merge, as squashing on receipt did; only steps
+  /// that receive material without trading it on skip the work.
+  void MergeBuf(cyclus::toolkit::ResBuf<cyclus::Material>* buf);
+
   #pragma cyclus var { \
     "doc": "Ordered list of commodities on which to requesting filler stream material.", \
     "uilabel": "Filler Stream Commodities", \
@@ -241,22 +373,59 @@ class FuelFab : public cyclus::Facility {
   #pragma cyclus var {		\
     "uilabel": "Spectrum type", \
     "uitype": "combobox", \
-    "categorical": ["fission_spectrum_ave", "thermal"], \
+    "categorical": ["fission_spectrum_ave", "thermal", "thermal_maxwell_ave", "resonance_integral", "fourteen_MeV"], \
     "doc": "The type of cross-sections to use for composition property calculation." \
            " Use 'fission_spectrum_ave' for fast reactor compositions or 'thermal' for thermal reactors.", \
   }
   std::string spectrum;
 
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "uilabel": "Record Performance", \
+    "doc": "If true, per-callback wall times and the number of requests, " \
+           "bids or trades handled are recorded to the ArchetypePerf table " \
+           "every time step.", \
+  }
+  bool record_perf;
+
+  // per-phase timings for the current time step
+  ArchetypePerf perf_;
+
+  // resolved from the spectrum state var in EnterNotify
+  CosiSpectrum spectrum_type_;
+
+  // shared with this facility's converters during the exchange
+  CosiCache cosi_cache_;
+
+  // resolved fill, fiss and topup recipes
+  RecipeHandle fill_rec_;
+  RecipeHandle fiss_rec_;
+  RecipeHandle topup_rec_;
+
+  // running mixes of the fill, fiss and topup buffers; rebuilt by SyncMix
+  // whenever they are out of step with the buffers (e.g. after a restart)
+  StreamMix fill_mix_;
+  StreamMix fiss_mix_;
+  StreamMix topup_mix_;
+
   // intra-time-step state - no need to be a state var
   // map<request, inventory name>
   std::map<cyclus::Request<cyclus::Material>*, std::string> req_inventories_;
+
+  friend class CallbackBench;
 };
 
 double CosiWeight(cyclus::Composition::Ptr c, const std::string& spectrum);
+double CosiWeight(cyclus::Composition::Ptr c, CosiSpectrum spectrum);
+CosiSpectrum SpectrumType(const std::string& spectrum);
+const char* SpectrumName(CosiSpectrum spectrum);
+double MolarMass(cyclus::Composition::Ptr c);
 bool ValidWeights(double w_low, double w_tgt, double w_high);
 double LowFrac(double w_low, double w_tgt, double w_high, double eps = 1e-6);
 double HighFrac(double w_low, double w_tgt, double w_high, double eps = 1e-6);
 double AtomToMassFrac(double atomfrac, cyclus::Composition::Ptr c1, cyclus::Composition::Ptr c2);
+double AtomToMassFrac(double atomfrac, double molar_mass1, double molar_mass2);
 
 } // namespace cycamore
 
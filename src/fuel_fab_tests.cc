@@ -121,6 +121,48 @@ TEST(FuelFabTests, CosiWeight) {
   EXPECT_GT(w_therm, w_fast);
 }
 
+TEST(FuelFabTests, CosiWeight_AllSpectra) {
+  cyclus::Env::SetNucDataPath();
+  CompMap m;
+  m[942390000] = 1;
+  Composition::Ptr pu = Composition::CreateFromMass(m);
+  m.clear();
+  m[922380000] = 1;
+  Composition::Ptr u = Composition::CreateFromMass(m);
+
+  for (int i = 0; i < N_SPECTRA; i++) {
+    CosiSpectrum s = static_cast<CosiSpectrum>(i);
+    EXPECT_EQ(s, SpectrumType(SpectrumName(s)));
+    EXPECT_DOUBLE_EQ(1.0, CosiWeight(pu, s)) << SpectrumName(s);
+    EXPECT_DOUBLE_EQ(0.0, CosiWeight(u, s)) << SpectrumName(s);
+    EXPECT_DOUBLE_EQ(CosiWeight(c_mox(), s), CosiWeight(c_mox(), SpectrumName(s)));
+  }
+
+  EXPECT_THROW(SpectrumType("not_a_spectrum"), cyclus::ValueError);
+}
+
+TEST(FuelFabTests, CosiCache) {
+  cyclus::Env::SetNucDataPath();
+  Composition::Ptr natu = c_natu();
+  Composition::Ptr pu = c_pustream();
+
+  CosiCache cache(THERMAL);
+  EXPECT_DOUBLE_EQ(CosiWeight(natu, THERMAL), cache.Weight(natu));
+  EXPECT_DOUBLE_EQ(MolarMass(natu), cache.MolarMass(natu));
+  EXPECT_DOUBLE_EQ(CosiWeight(pu, THERMAL), cache.Weight(pu));
+  EXPECT_DOUBLE_EQ(CosiWeight(pu, THERMAL), cache.Weight(pu));
+  EXPECT_EQ(2, cache.misses());
+  EXPECT_EQ(2, cache.hits());
+
+  cache.Reset(FISSION_SPECTRUM_AVE);
+  EXPECT_DOUBLE_EQ(CosiWeight(pu, FISSION_SPECTRUM_AVE), cache.Weight(pu));
+  EXPECT_EQ(3, cache.misses());
+  EXPECT_DOUBLE_EQ(0.4, cache.hit_rate());
+  cache.Reset(FISSION_SPECTRUM_AVE);
+  cache.Weight(pu);
+  EXPECT_EQ(3, cache.hits()) << "same spectrum reset must keep entries";
+}
+
 TEST(FuelFabTests, CosiWeight_Mixed) {
   cyclus::Env::SetNucDataPath();
   double w_fill = CosiWeight(c_natu(), "thermal");
@@ -141,6 +183,70 @@ TEST(FuelFabTests, CosiWeight_Mixed) {
   EXPECT_LT(std::abs((w_target-got)/w_target), 0.00001) << "mixed composition not within 0.001% of target";
 }
 
+TEST(FuelFabTests, StreamMix) {
+  // a running mix must weigh the same as, and have the composition of, its
+  // materials merged into one
+  cyclus::Env::SetNucDataPath();
+  Material::Ptr m1 = Material::CreateUntracked(3, c_natu());
+  Material::Ptr m2 = Material::CreateUntracked(1, c_pustream());
+
+  StreamMix mix;
+  EXPECT_TRUE(mix.comp().get() == NULL);
+  mix.Add(m1->quantity(), c_natu(), CosiWeight(c_natu(), THERMAL),
+          MolarMass(c_natu()));
+  mix.Add(m2->quantity(), c_pustream(), CosiWeight(c_pustream(), THERMAL),
+          MolarMass(c_pustream()));
+  m1->Absorb(m2);
+
+  EXPECT_DOUBLE_EQ(4, mix.qty);
+  EXPECT_NEAR(CosiWeight(m1->comp(), THERMAL), mix.weight(), 1e-12);
+  EXPECT_NEAR(MolarMass(m1->comp()), mix.molar_mass(), 1e-9);
+
+  CompMap want = m1->comp()->mass();
+  CompMap got = mix.comp()->mass();
+  cyclus::compmath::Normalize(&want);
+  cyclus::compmath::Normalize(&got);
+  ASSERT_EQ(want.size(), got.size());
+  for (CompMap::iterator it = want.begin(); it != want.end(); ++it) {
+    EXPECT_NEAR(it->second, got[it->first], 1e-12);
+  }
+
+  double w = mix.weight();
+  Composition::Ptr c = mix.comp();
+  mix.Scale(1);
+  EXPECT_DOUBLE_EQ(1, mix.qty);
+  EXPECT_NEAR(w, mix.weight(), 1e-12);
+  EXPECT_EQ(c, mix.comp());
+  mix.Scale(0);
+  EXPECT_DOUBLE_EQ(0, mix.weight());
+  EXPECT_TRUE(mix.comp().get() == NULL);
+}
+
+TEST(FuelFabTests, AtomToMassFrac_MolarMass) {
+  cyclus::Env::SetNucDataPath();
+  Composition::Ptr c1 = c_pustream();
+  Composition::Ptr c2 = c_natu();
+
+  CompMap n1 = c1->atom();
+  CompMap n2 = c2->atom();
+  cyclus::compmath::Normalize(&n1, 0.3);
+  cyclus::compmath::Normalize(&n2, 0.7);
+  double mass1 = 0;
+  for (CompMap::iterator it = n1.begin(); it != n1.end(); ++it) {
+    mass1 += it->second * pyne::atomic_mass(it->first);
+  }
+  double mass2 = 0;
+  for (CompMap::iterator it = n2.begin(); it != n2.end(); ++it) {
+    mass2 += it->second * pyne::atomic_mass(it->first);
+  }
+  double want = mass1 / (mass1 + mass2);
+
+  EXPECT_NEAR(want, AtomToMassFrac(0.3, c1, c2), 1e-12);
+  EXPECT_NEAR(want, AtomToMassFrac(0.3, MolarMass(c1), MolarMass(c2)), 1e-12);
+  EXPECT_DOUBLE_EQ(0.0, AtomToMassFrac(0.0, MolarMass(c1), MolarMass(c2)));
+  EXPECT_DOUBLE_EQ(1.0, AtomToMassFrac(1.0, MolarMass(c1), MolarMass(c2)));
+}
+
 TEST(FuelFabTests, HighFrac) {
   cyclus::Env::SetNucDataPath();
   double w_fill = CosiWeight(c_natu(), "thermal");
@@ -540,6 +646,49 @@ TEST(FuelFabTests, CorrectMixing) {
   EXPECT_NEAR(0.25361268029, m->quantity(), 1e-6) << "mixed wrong amount of Pu stream";
 }
 
+// many identical requests share one mixing solution and are all supplied
+// with fuel of the requested weight.
+TEST(FuelFabTests, IdenticalRequests) {
+  std::string config =
+     "<fill_commods> <val>natu</val> </fill_commods>"
+     "<fill_recipe>natu</fill_recipe>"
+     "<fill_size>100</fill_size>"
+     ""
+     "<fiss_commods> <val>pustream</val> </fiss_commods>"
+     "<fiss_recipe>pustream</fiss_recipe>"
+     "<fiss_size>100</fiss_size>"
+     ""
+     "<outcommod>recyclefuel</outcommod>"
+     "<spectrum>thermal</spectrum>"
+     "<throughput>100</throughput>"
+     ;
+  int simdur = 3;
+  int nsinks = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:FuelFab"), config, simdur);
+  sim.AddSource("pustream").Finalize();
+  sim.AddSource("natu").Finalize();
+  for (int i = 0; i < nsinks; i++) {
+    sim.AddSink("recyclefuel").recipe("uox").capacity(2).lifetime(2).Finalize();
+  }
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("pustream", c_pustream());
+  sim.AddRecipe("natu", c_natu());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Commodity", "==", std::string("recyclefuel")));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(nsinks, qr.rows.size());
+
+  double w_target = CosiWeight(c_uox(), "thermal");
+  for (int i = 0; i < qr.rows.size(); i++) {
+    Material::Ptr m = sim.GetMaterial(qr.GetVal<int>("ResourceId", i));
+    EXPECT_NEAR(2, m->quantity(), 1e-6);
+    double got = CosiWeight(m->comp(), "thermal");
+    EXPECT_LT(std::abs((w_target-got)/w_target), 0.00001) << "mixed composition not within 0.001% of target";
+  }
+}
+
 // fuel is requested requiring more filler than is available with plenty of
 // fissile.
 TEST(FuelFabTests, FillConstrained) {
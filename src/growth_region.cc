@@ -1,9 +1,19 @@
 // Implements the GrowthRegion class
 #include "growth_region.h"
 
+#include <cmath>
+
+#include "manager_inst.h"
+
 namespace cycamore {
 
-GrowthRegion::GrowthRegion(cyclus::Context* ctx) : cyclus::Region(ctx) {
+GrowthRegion::GrowthRegion(cyclus::Context* ctx)
+    : cyclus::Region(ctx),
+      build_bucket(0),
+      record_perf(false),
+      builder_version_(0),
+      build_cache_version_(0),
+      perf_(PERF_TICK) {
 #if !CYCLUS_HAS_COIN
   throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
                       "with COIN support.");
@@ -68,6 +78,19 @@ void GrowthRegion::Register_(cyclus::Agent* agent) {
                                    << agent->prototype() << agent->id()
                                    << " as a commodity producer manager.";
     sdmanager_.RegisterProducerManager(cpm_cast);
+
+    // only managers known to report their producer changes can be folded
+    // into the running totals
+    ManagerInst* mi_cast = dynamic_cast<ManagerInst*>(agent);
+    if (mi_cast != NULL) {
+      tracked_[cpm_cast] = mi_cast;
+      std::map<std::string, double>::iterator it;
+      for (it = supply_.begin(); it != supply_.end(); ++it) {
+        it->second = TrackedSupply_(it->first);
+      }
+    } else {
+      untracked_.insert(cpm_cast);
+    }
   }
 
   Builder* b_cast = dynamic_cast<Builder*>(agent);
@@ -76,6 +99,7 @@ void GrowthRegion::Register_(cyclus::Agent* agent) {
                                    << agent->prototype() << agent->id()
                                    << " as a builder.";
     buildmanager_.Register(b_cast);
+    builder_version_++;
   }
 #else
   throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
@@ -89,27 +113,98 @@ void GrowthRegion::Unregister_(cyclus::Agent* agent) {
 #if CYCLUS_HAS_COIN
   CommodityProducerManager* cpm_cast =
     dynamic_cast<CommodityProducerManager*>(agent);
-  if (cpm_cast != NULL)
+  if (cpm_cast != NULL) {
     sdmanager_.UnregisterProducerManager(cpm_cast);
+    std::map<CommodityProducerManager*, ManagerInst*>::iterator mit =
+        tracked_.find(cpm_cast);
+    if (mit != tracked_.end()) {
+      tracked_.erase(mit);
+      std::map<std::string, double>::iterator it;
+      for (it = supply_.begin(); it != supply_.end(); ++it) {
+        it->second = TrackedSupply_(it->first);
+      }
+    }
+    untracked_.erase(cpm_cast);
+  }
 
   Builder* b_cast = dynamic_cast<Builder*>(agent);
-  if (b_cast != NULL)
+  if (b_cast != NULL) {
     buildmanager_.Unregister(b_cast);
+    builder_version_++;
+  }
 #else
   throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
                       "with COIN support.");
 #endif
 }
 
+void GrowthRegion::ProducerNotify(
+    cyclus::toolkit::CommodityProducerManager* manager,
+    cyclus::toolkit::CommodityProducer* producer,
+    int sign) {
+  if (tracked_.count(manager) == 0) {
+    return;
+  }
+
+  std::map<std::string, double>::iterator it;
+  for (it = supply_.begin(); it != supply_.end(); ++it) {
+    if (producer->Produces(cyclus::toolkit::Commodity(it->first))) {
+      it->second = TrackedSupply_(it->first);
+    }
+  }
+}
+
+double GrowthRegion::TrackedSupply_(const std::string& commod) {
+  using cyclus::toolkit::CommodityProducerManager;
+  cyclus::toolkit::Commodity c(commod);
+  double total = 0;
+  std::map<CommodityProducerManager*, ManagerInst*>::iterator it;
+  for (it = tracked_.begin(); it != tracked_.end(); ++it) {
+    total += it->second->AggregateCapacity(c);
+  }
+  return total;
+}
+
+double GrowthRegion::Supply_(const std::string& commod) {
+  using cyclus::toolkit::CommodityProducerManager;
+  cyclus::toolkit::Commodity c(commod);
+  std::map<std::string, double>::iterator it = supply_.find(commod);
+  if (it == supply_.end()) {
+    it = supply_.insert(std::make_pair(commod, TrackedSupply_(commod))).first;
+  }
+
+  double supply = it->second;
+  std::set<CommodityProducerManager*>::iterator mit;
+  for (mit = untracked_.begin(); mit != untracked_.end(); ++mit) {
+    supply += (*mit)->TotalCapacity(c);
+  }
+  return supply;
+}
+
+double GrowthRegion::Demand_(const std::string& commod, int time) {
+  std::map<std::string, std::pair<int, double> >::iterator it =
+      demand_cache_.find(commod);
+  if (it != demand_cache_.end() && it->second.first == time) {
+    return it->second.second;
+  }
+
+  cyclus::toolkit::Commodity c(commod);
+  double demand = sdmanager_.Demand(c, time);
+  demand_cache_[commod] = std::make_pair(time, demand);
+  return demand;
+}
+
 void GrowthRegion::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
+  scope.Count(commodity_demand.size());
   double demand, supply, unmetdemand;
   cyclus::toolkit::Commodity commod;
   int time = context()->time();
   std::map<std::string, Demand>::iterator it;
   for (it = commodity_demand.begin(); it != commodity_demand.end(); ++it) {
     commod = cyclus::toolkit::Commodity(it->first);
-    demand = sdmanager_.Demand(commod, time);
-    supply = sdmanager_.Supply(commod);
+    demand = Demand_(it->first, time);
+    supply = Supply_(it->first);
     unmetdemand = demand - supply;
 
     LOG(cyclus::LEV_INFO3, "greg") << "GrowthRegion: " << prototype()
@@ -120,7 +215,7 @@ void GrowthRegion::Tick() {
     LOG(cyclus::LEV_INFO3, "greg") << "  * supply = " << supply;
     LOG(cyclus::LEV_INFO3, "greg") << "  * unmet demand = " << unmetdemand;
 
-    if (unmetdemand > 0) {
+    if (unmetdemand > cyclus::eps()) {
       OrderBuilds(commod, unmetdemand);
     }
   }
@@ -129,6 +224,54 @@ void GrowthRegion::Tick() {
 
 void GrowthRegion::OrderBuilds(cyclus::toolkit::Commodity& commodity,
                                double unmetdemand) {
+#if CYCLUS_HAS_COIN
+  std::vector<BuildPlan> computed;
+  const std::vector<BuildPlan>* plans = &computed;
+  if (build_bucket > 0) {
+    plans = &CachedPlans_(commodity, unmetdemand);
+  } else {
+    computed = PlanBuilds_(commodity, unmetdemand);
+  }
+
+  for (int i = 0; i < plans->size(); i++) {
+    const BuildPlan& plan = (*plans)[i];
+    SchedBuilds_(plan.builder, plan.prototype, plan.number);
+  }
+#else
+  throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
+                      "with COIN support.");
+#endif
+}
+
+const std::vector<BuildPlan>& GrowthRegion::CachedPlans_(
+    cyclus::toolkit::Commodity& commodity,
+    double unmetdemand) {
+  if (build_cache_version_ != builder_version_) {
+    build_cache_.clear();
+    build_cache_version_ = builder_version_;
+  }
+
+  long bucket = static_cast<long>(std::ceil(unmetdemand / build_bucket));
+  std::pair<std::string, long> key(commodity.name(), bucket);
+  std::map<std::pair<std::string, long>, std::vector<BuildPlan> >::iterator
+      it = build_cache_.find(key);
+  if (it == build_cache_.end()) {
+    // plan for the top of the bucket so that the decision covers every
+    // unmet demand it is reused for
+    it = build_cache_.insert(std::make_pair(
+        key, PlanBuilds_(commodity, bucket * build_bucket))).first;
+  } else {
+    LOG(cyclus::LEV_INFO3, "greg")
+        << "Reusing the build decision for commodity " << commodity.name()
+        << " in unmet demand bucket " << key.second << ".";
+  }
+  return it->second;
+}
+
+std::vector<BuildPlan> GrowthRegion::PlanBuilds_(
+    cyclus::toolkit::Commodity& commodity,
+    double unmetdemand) {
+  std::vector<BuildPlan> plans;
 #if CYCLUS_HAS_COIN
   using std::vector;
   vector<cyclus::toolkit::BuildOrder> orders =
@@ -151,22 +294,29 @@ void GrowthRegion::OrderBuilds(cyclus::toolkit::Commodity& commodity,
                               "cast an already known entity.");
     }
 
-    LOG(cyclus::LEV_INFO3, "greg")
-        << "A build order for " << order->number
-        << " prototype(s) of type "
-        << dynamic_cast<cyclus::Agent*>(agentcast)->prototype()
-        << " from builder " << instcast->prototype()
-        << " is being placed.";
-
-    for (int j = 0; j < order->number; j++) {
-      LOG(cyclus::LEV_DEBUG2, "greg") << "Ordering build number: " << j + 1;
-      context()->SchedBuild(instcast, agentcast->prototype());
-    }
+    BuildPlan plan;
+    plan.builder = instcast;
+    plan.prototype = agentcast->prototype();
+    plan.number = order->number;
+    plans.push_back(plan);
   }
-#else
-  throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
-                      "with COIN support.");
 #endif
+  return plans;
+}
+
+void GrowthRegion::SchedBuilds_(cyclus::Institution* builder,
+                                const std::string& proto,
+                                int n) {
+  LOG(cyclus::LEV_INFO3, "greg")
+      << "A build order for " << n
+      << " prototype(s) of type " << proto
+      << " from builder " << builder->prototype()
+      << " is being placed.";
+
+  cyclus::Context* ctx = context();
+  for (int j = 0; j < n; j++) {
+    ctx->SchedBuild(builder, proto);
+  }
 }
 
 extern "C" cyclus::Agent* ConstructGrowthRegion(cyclus::Context* ctx) {
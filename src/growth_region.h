@@ -1,16 +1,20 @@
 #ifndef CYCAMORE_SRC_GROWTH_REGION_H_
 #define CYCAMORE_SRC_GROWTH_REGION_H_
 
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
 
 // forward declarations
 namespace cycamore {
 class GrowthRegion;
+class ManagerInst;
 }  // namespace cycamore
 
 // forward includes
@@ -22,6 +26,14 @@ namespace cycamore {
 typedef std::vector<
   std::pair<int, std::pair<std::string, std::string> > > Demand;
 
+/// A resolved build order: a number of builds of a prototype to be placed
+/// with an institution
+struct BuildPlan {
+  cyclus::Institution* builder;
+  std::string prototype;
+  int number;
+};
+
 /// This region determines if there is a need to meet a certain
 /// capacity (as defined via input) at each time step. If there is
 /// such a need, the region will determine how many of each facility
@@ -68,6 +80,17 @@ class GrowthRegion : public cyclus::Region {
     return &sdmanager_;
   }
 
+  /// notify the region that a producer managed by one of its children has
+  /// been built (sign > 0) or decommissioned (sign < 0), so that the running
+  /// supply totals can be kept current without walking every producer.  The
+  /// manager's own aggregates must already include the change.
+  /// @param manager the producer manager that owns the producer
+  /// @param producer the producer being added or removed
+  /// @param sign the direction of the change
+  void ProducerNotify(cyclus::toolkit::CommodityProducerManager* manager,
+                      cyclus::toolkit::CommodityProducer* producer,
+                      int sign);
+
  protected:
   #pragma cyclus var { \
     "alias": ["growth", "commod", \
@@ -103,6 +126,32 @@ class GrowthRegion : public cyclus::Region {
   }
   std::map<std::string, std::vector<std::pair<int, std::pair<std::string, std::string> > > > commodity_demand; // must match Demand typedef
 
+  #pragma cyclus var { \
+    "default": 0, \
+    "userlevel": 10, \
+    "tooltip": "unmet demand bucket width for reusing build decisions", \
+    "uilabel": "Build Decision Bucket", \
+    "doc": "If positive, build decisions are cached per commodity and per " \
+           "bucket of this width of unmet demand, and reused while the set " \
+           "of builders is unchanged, instead of being solved again every " \
+           "time step. Each decision is made for the top of its bucket, so " \
+           "up to one bucket width more capacity than needed may be built; " \
+           "the width should be small relative to the capacity of the " \
+           "prototypes being built. Zero disables the cache.", \
+  }
+  double build_bucket;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "record Tick timings", \
+    "uilabel": "Record Performance", \
+    "doc": "If true, the wall time spent evaluating demand and ordering " \
+           "builds in each Tick is recorded to the ArchetypePerf table, " \
+           "with the number of commodities evaluated.", \
+  }
+  bool record_perf;
+
 #if CYCLUS_HAS_COIN
   /// manager for building things
   cyclus::toolkit::BuildingManager buildmanager_;
@@ -117,6 +166,34 @@ class GrowthRegion : public cyclus::Region {
   /// unregister a child
   void Unregister_(cyclus::Agent* agent);
 
+  /// the current supply of a commodity, read from the running totals for
+  /// managers that report producer changes and queried directly from any
+  /// other managers
+  double Supply_(const std::string& commod);
+
+  /// the supply of a commodity summed over the tracked managers' aggregate
+  /// capacities, one term per manager rather than per producer
+  double TrackedSupply_(const std::string& commod);
+
+  /// the demand for a commodity at a given time, evaluated at most once per
+  /// time
+  double Demand_(const std::string& commod, int time);
+
+  /// supply totals per commodity for the tracked managers, filled lazily on
+  /// first use of a commodity and recomputed from the managers' aggregates
+  /// whenever one changes, so that they do not drift with repeated builds and
+  /// decommissions
+  std::map<std::string, double> supply_;
+
+  /// producer managers that report producer changes via ProducerNotify
+  std::map<cyclus::toolkit::CommodityProducerManager*, ManagerInst*> tracked_;
+
+  /// producer managers that must be queried for their capacity each time
+  std::set<cyclus::toolkit::CommodityProducerManager*> untracked_;
+
+  /// last evaluated demand per commodity as (time, demand)
+  std::map<std::string, std::pair<int, double> > demand_cache_;
+
   /// add a demand for a commodity on which this region request that
   /// facilities be built
   void AddCommodityDemand_(std::string commod, Demand& demand);
@@ -126,6 +203,35 @@ class GrowthRegion : public cyclus::Region {
   /// @param commodity the commodity being demanded
   /// @param unmetdemand the unmet demand
   void OrderBuilds(cyclus::toolkit::Commodity& commodity, double unmetdemand);
+
+  /// solves for the builds needed to meet an unmet demand
+  std::vector<BuildPlan> PlanBuilds_(cyclus::toolkit::Commodity& commodity,
+                                     double unmetdemand);
+
+  /// the cached build decision for the bucket of unmet demand, solved for the
+  /// bucket's upper bound when it is missing.  The cache is dropped whenever
+  /// the set of builders has changed.
+  const std::vector<BuildPlan>& CachedPlans_(
+      cyclus::toolkit::Commodity& commodity, double unmetdemand);
+
+  /// schedules n builds of a prototype with an institution
+  void SchedBuilds_(cyclus::Institution* builder, const std::string& proto,
+                    int n);
+
+  /// incremented whenever a builder is registered or unregistered
+  int builder_version_;
+
+  /// the builder version the cached build decisions were made with
+  int build_cache_version_;
+
+  /// cached build decisions keyed by (commodity, unmet demand bucket), where
+  /// bucket n holds unmet demands in ((n - 1) * build_bucket, n * build_bucket]
+  std::map<std::pair<std::string, long>, std::vector<BuildPlan> >
+      build_cache_;
+
+  /// Tick timings; a region has no exchange or Tock work of its own, so each
+  /// time step is recorded when its Tick closes
+  ArchetypePerf perf_;
 };
 }  // namespace cycamore
 
@@ -3,6 +3,8 @@
 #include "growth_region_tests.h"
 #if CYCLUS_HAS_COIN
 
+#include "manager_inst_tests.h"
+
 namespace cycamore {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -34,6 +36,115 @@ TEST_F(GrowthRegionTests, init) {
   EXPECT_TRUE(ManagesCommodity(commodity));
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(GrowthRegionTests, RunningSupply) {
+  cyclus::toolkit::Commodity commodity(commodity_name);
+  cycamore::ManagerInst* inst = new cycamore::ManagerInst(ctx);
+  inst->Build(region);
+  TestProducer* producer = new TestProducer(ctx);
+  producer->cyclus::toolkit::CommodityProducer::Add(commodity);
+  producer->SetCapacity(commodity, 5);
+
+  // producers present before registration are picked up on first use
+  inst->BuildNotify(producer);
+  Register(inst);
+  EXPECT_DOUBLE_EQ(5, Supply(commodity_name));
+  EXPECT_DOUBLE_EQ(0, Supply("other"));
+
+  // later changes reach the region through the institution's parent
+  inst->DecomNotify(producer);
+  EXPECT_DOUBLE_EQ(0, Supply(commodity_name));
+  inst->BuildNotify(producer);
+  EXPECT_DOUBLE_EQ(5, Supply(commodity_name));
+
+  Unregister(inst);
+  EXPECT_DOUBLE_EQ(0, Supply(commodity_name));
+
+  delete producer;
+  delete inst;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(GrowthRegionTests, RunningSupplyNoDrift) {
+  cyclus::toolkit::Commodity commodity(commodity_name);
+  cycamore::ManagerInst* inst = new cycamore::ManagerInst(ctx);
+  inst->Build(region);
+  Register(inst);
+  TestProducer* p1 = new TestProducer(ctx);
+  p1->cyclus::toolkit::CommodityProducer::Add(commodity);
+  p1->SetCapacity(commodity, 0.1);
+  TestProducer* p2 = new TestProducer(ctx);
+  p2->cyclus::toolkit::CommodityProducer::Add(commodity);
+  p2->SetCapacity(commodity, 0.2);
+
+  // 0.1 + 0.2 - 0.1 - 0.2 leaves a residue in floating point; with every
+  // producer gone the supply must be exactly zero so no build is ordered
+  EXPECT_DOUBLE_EQ(0, Supply(commodity_name));
+  inst->BuildNotify(p1);
+  inst->BuildNotify(p2);
+  EXPECT_DOUBLE_EQ(0.3, Supply(commodity_name));
+  inst->DecomNotify(p1);
+  inst->DecomNotify(p2);
+  EXPECT_EQ(0, Supply(commodity_name));
+  EXPECT_EQ(0, inst->AggregateCapacity(commodity));
+
+  Unregister(inst);
+  delete p2;
+  delete p1;
+  delete inst;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(GrowthRegionTests, BuildBucket) {
+  cyclus::toolkit::Commodity commodity(commodity_name);
+  BuildBucket(5);
+
+  cycamore::ManagerInst* inst = new cycamore::ManagerInst(ctx);
+  TestProducer* proto = new TestProducer(ctx);
+  proto->cyclus::toolkit::CommodityProducer::Add(commodity);
+  proto->SetCapacity(commodity, 5);
+  proto->SetCost(commodity, 2);
+  inst->cyclus::toolkit::Builder::Register(proto);
+  Register(inst);
+
+  // a decision is made for the top of its bucket, so an unmet demand of 7
+  // is planned as 10 and gets two builds
+  const std::vector<BuildPlan>* plans = &Plans(commodity, 7);
+  ASSERT_EQ(1, plans->size());
+  EXPECT_EQ(inst, (*plans)[0].builder);
+  EXPECT_EQ(2, (*plans)[0].number);
+
+  // demands in the same bucket reuse the decision, which covers them all
+  EXPECT_EQ(plans, &Plans(commodity, 10));
+  EXPECT_EQ(plans, &Plans(commodity, 5.5));
+
+  // the next bucket is solved on its own
+  const std::vector<BuildPlan>& next = Plans(commodity, 10.5);
+  EXPECT_NE(plans, &next);
+  ASSERT_EQ(1, next.size());
+  EXPECT_EQ(3, next[0].number);
+
+  // a new builder with a cheaper prototype invalidates the cache
+  cycamore::ManagerInst* cheap = new cycamore::ManagerInst(ctx);
+  TestProducer* cheap_proto = new TestProducer(ctx);
+  cheap_proto->cyclus::toolkit::CommodityProducer::Add(commodity);
+  cheap_proto->SetCapacity(commodity, 5);
+  cheap_proto->SetCost(commodity, 1);
+  cheap->cyclus::toolkit::Builder::Register(cheap_proto);
+  Register(cheap);
+  plans = &Plans(commodity, 7);
+  ASSERT_EQ(1, plans->size());
+  EXPECT_EQ(cheap, (*plans)[0].builder);
+  EXPECT_EQ(2, (*plans)[0].number);
+
+  Unregister(cheap);
+  Unregister(inst);
+  delete cheap_proto;
+  delete cheap;
+  delete proto;
+  delete inst;
+}
+
 }  // namespace cycamore
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
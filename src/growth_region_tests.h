@@ -29,6 +29,14 @@ class GrowthRegionTests : public ::testing::Test {
   virtual void SetUp();
   virtual void TearDown();
   bool ManagesCommodity(cyclus::toolkit::Commodity& commodity);
+  void Register(cyclus::Agent* a) { region->Register_(a); }
+  void Unregister(cyclus::Agent* a) { region->Unregister_(a); }
+  double Supply(std::string commod) { return region->Supply_(commod); }
+  void BuildBucket(double width) { region->build_bucket = width; }
+  const std::vector<BuildPlan>& Plans(cyclus::toolkit::Commodity& commodity,
+                                      double unmetdemand) {
+    return region->CachedPlans_(commodity, unmetdemand);
+  }
 };
 
 }  // namespace cycamore
@@ -0,0 +1,95 @@
+#ifndef CYCAMORE_SRC_INVENTORY_FOOTPRINT_H_
+#define CYCAMORE_SRC_INVENTORY_FOOTPRINT_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+#include "datum_stage.h"
+
+namespace cycamore {
+
+/// Collects the number of resource objects, total quantity and number of
+/// distinct material compositions held in each of an agent's buffers, and
+/// writes them to the InventoryFootprint table with one row per buffer.
+/// Archetypes with a nonzero footprint_interval build one of these every
+/// footprint_interval time steps.
+class InventoryFootprint {
+ public:
+  /// @return whether a footprint is due at time t when one is recorded every
+  /// interval time steps; never if interval is not positive
+  static bool Due(int interval, int t) {
+    return interval > 0 && t % interval == 0;
+  }
+
+  /// adds a row for the resources in rs, any container of resource pointers
+  template <class Container>
+  void Add(const std::string& buffer, const Container& rs) {
+    Row row;
+    row.buffer = buffer;
+    row.count = 0;
+    row.quantity = 0;
+    std::set<int> comps;
+    typename Container::const_iterator it;
+    for (it = rs.begin(); it != rs.end(); ++it) {
+      row.count++;
+      row.quantity += (*it)->quantity();
+      if ((*it)->type() == cyclus::Material::kType) {
+        comps.insert(cyclus::ResCast<cyclus::Material>(*it)->comp()->id());
+      }
+    }
+    row.ncomps = comps.size();
+    rows_.push_back(row);
+  }
+
+  /// adds a row for a resource buffer.  The buffer is read by popping and
+  /// re-pushing all of its resources, leaving it as it was.
+  template <class T>
+  void AddBuf(const std::string& buffer, cyclus::toolkit::ResBuf<T>* buf) {
+    std::vector<typename T::Ptr> rs = buf->PopN(buf->count());
+    buf->Push(rs);
+    Add(buffer, rs);
+  }
+
+  /// writes the rows added so far.  Agents that may run concurrently have
+  /// the rows staged.
+  void Record(cyclus::Agent* agent) {
+    ConcurrentTimeListener* c = dynamic_cast<ConcurrentTimeListener*>(agent);
+    if (c == NULL) {
+      Write_(agent, rows_);
+    } else {
+      std::vector<Row> rows(rows_);
+      c->datum_stage().Write([agent, rows]() { Write_(agent, rows); });
+    }
+    rows_.clear();
+  }
+
+ private:
+  struct Row {
+    std::string buffer;
+    int count;
+    double quantity;
+    int ncomps;
+  };
+
+  static void Write_(cyclus::Agent* agent, const std::vector<Row>& rows) {
+    for (int i = 0; i < rows.size(); i++) {
+      agent->context()
+          ->NewDatum("InventoryFootprint")
+          ->AddVal("AgentId", agent->id())
+          ->AddVal("Time", agent->context()->time())
+          ->AddVal("Buffer", rows[i].buffer)
+          ->AddVal("Count", rows[i].count)
+          ->AddVal("Quantity", rows[i].quantity)
+          ->AddVal("Compositions", rows[i].ncomps)
+          ->Record();
+    }
+  }
+
+  std::vector<Row> rows_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_INVENTORY_FOOTPRINT_H_
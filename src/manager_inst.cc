@@ -1,6 +1,10 @@
 // Implements the ManagerInst class
 #include "manager_inst.h"
 
+#include <cmath>
+
+#include "growth_region.h"
+
 namespace cycamore {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -50,7 +54,12 @@ void ManagerInst::Register_(Agent* a) {
     LOG(cyclus::LEV_INFO3, "mani") << "Registering agent "
                                    << a->prototype() << a->id()
                                    << " as a commodity producer.";
+    bool added = CommodityProducerManager::producers().count(cp_cast) == 0;
     CommodityProducerManager::Register(cp_cast);
+    if (added) {
+      Aggregate_(cp_cast, 1);
+      NotifyRegion_(cp_cast, 1);
+    }
   }
 }
 
@@ -59,8 +68,56 @@ void ManagerInst::Unregister_(Agent* a) {
   using cyclus::toolkit::CommodityProducerManager;
 
   CommodityProducer* cp_cast = dynamic_cast<CommodityProducer*>(a);
-  if (cp_cast != NULL)
+  if (cp_cast != NULL &&
+      CommodityProducerManager::producers().count(cp_cast) > 0) {
+    Aggregate_(cp_cast, -1);
+    NotifyRegion_(cp_cast, -1);
     CommodityProducerManager::Unregister(cp_cast);
+  }
+}
+
+void ManagerInst::NotifyRegion_(cyclus::toolkit::CommodityProducer* producer,
+                                int sign) {
+  GrowthRegion* region = dynamic_cast<GrowthRegion*>(parent());
+  if (region != NULL)
+    region->ProducerNotify(this, producer, sign);
+}
+
+void ManagerInst::Aggregate_(cyclus::toolkit::CommodityProducer* producer,
+                             int sign) {
+  using cyclus::toolkit::Commodity;
+  using cyclus::toolkit::CommodityCompare;
+  std::set<Commodity, CommodityCompare> commods =
+      producer->ProducedCommodities();
+  std::set<Commodity, CommodityCompare>::iterator it;
+  for (it = commods.begin(); it != commods.end(); ++it) {
+    double& capacity = capacity_[it->name()];
+    double& cost = cost_[it->name()];
+    capacity += sign * producer->Capacity(*it);
+    cost += sign * producer->Cost(*it);
+
+    // removing every producer leaves rounding residue rather than zero
+    if (std::abs(capacity) < cyclus::eps()) {
+      capacity = 0;
+    }
+    if (std::abs(cost) < cyclus::eps()) {
+      cost = 0;
+    }
+  }
+}
+
+double ManagerInst::AggregateCapacity(
+    const cyclus::toolkit::Commodity& commod) const {
+  std::map<std::string, double>::const_iterator it =
+      capacity_.find(commod.name());
+  return it != capacity_.end() ? it->second : 0;
+}
+
+double ManagerInst::AggregateCost(
+    const cyclus::toolkit::Commodity& commod) const {
+  std::map<std::string, double>::const_iterator it =
+      cost_.find(commod.name());
+  return it != cost_.end() ? it->second : 0;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -38,6 +38,16 @@ class ManagerInst
   /// unregister a child
   virtual void DecomNotify(Agent* m);
 
+  /// the total capacity of a commodity over all managed producers, kept as a
+  /// running total as producers are built and decommissioned
+  /// @param commod the commodity
+  double AggregateCapacity(const cyclus::toolkit::Commodity& commod) const;
+
+  /// the total production cost of a commodity over all managed producers,
+  /// kept as a running total as producers are built and decommissioned
+  /// @param commod the commodity
+  double AggregateCost(const cyclus::toolkit::Commodity& commod) const;
+
   /// write information about a commodity producer to a stream
   /// @param producer the producer
   void WriteProducerInformation(cyclus::toolkit::CommodityProducer*
@@ -50,6 +60,20 @@ class ManagerInst
   /// unregister a child
   void Unregister_(cyclus::Agent* agent);
 
+  /// forward a producer change to the parent region if it keeps running
+  /// supply totals
+  void NotifyRegion_(cyclus::toolkit::CommodityProducer* producer, int sign);
+
+  /// adds (sign > 0) or removes (sign < 0) a producer's capacity and cost
+  /// from the running totals
+  void Aggregate_(cyclus::toolkit::CommodityProducer* producer, int sign);
+
+  /// running capacity per commodity name
+  std::map<std::string, double> capacity_;
+
+  /// running cost per commodity name
+  std::map<std::string, double> cost_;
+
   #pragma cyclus var { \
     "tooltip": "producer facility prototypes",                          \
     "uilabel": "Producer Prototype List",                               \
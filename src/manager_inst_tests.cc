@@ -53,6 +53,23 @@ TEST_F(ManagerInstTests, productioncapacity) {
   EXPECT_EQ(src_inst->TotalCapacity(commodity), 0);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ManagerInstTests, AggregateCapacity) {
+  EXPECT_DOUBLE_EQ(0, src_inst->AggregateCapacity(commodity));
+  src_inst->BuildNotify(producer);
+  EXPECT_DOUBLE_EQ(capacity, src_inst->AggregateCapacity(commodity));
+  EXPECT_DOUBLE_EQ(src_inst->TotalCapacity(commodity),
+                   src_inst->AggregateCapacity(commodity));
+
+  // repeated notifications for a known producer are not double counted
+  src_inst->BuildNotify(producer);
+  EXPECT_DOUBLE_EQ(capacity, src_inst->AggregateCapacity(commodity));
+
+  src_inst->DecomNotify(producer);
+  EXPECT_DOUBLE_EQ(0, src_inst->AggregateCapacity(commodity));
+  EXPECT_DOUBLE_EQ(0, src_inst->AggregateCost(commodity));
+}
+
 // required to get functionality in cyclus agent unit tests library
 #ifndef CYCLUS_AGENT_TESTS_CONNECTED
 int ConnectAgentTests();
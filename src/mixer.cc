@@ -4,7 +4,11 @@
 
 namespace cycamore {
 
-Mixer::Mixer(cyclus::Context* ctx) : cyclus::Facility(ctx), throughput(0) {
+Mixer::Mixer(cyclus::Context* ctx)
+    : cyclus::Facility(ctx),
+      throughput(0),
+      mix_single_comp(false),
+      record_perf(false) {
   cyclus::Warn<cyclus::EXPERIMENTAL_WARNING>(
       "the Mixer archetype is experimental");
 }
@@ -28,11 +32,13 @@ cyclus::Inventories Mixer::SnapshotInv() {
 }
 
 void Mixer::InitInv(cyclus::Inventories& inv) {
-  inv["output-inv-name"] = output.PopNRes(output.count());
   output.Push(inv["output-inv-name"]);
 
   cyclus::Inventories::iterator it;
   for (it = inv.begin(); it != inv.end(); ++it) {
+    if (it->first == "output-inv-name") {
+      continue;
+    }
     streambufs[it->first].Push(it->second);
   }
 }
@@ -86,54 +92,103 @@ void Mixer::EnterNotify() {
     }
   }
 
+  IndexStreams_();
   sell_policy.Init(this, &output, "output").Set(out_commod).Start();
 }
 
+void Mixer::IndexStreams_() {
+  in_bufs_.clear();
+  mix_key_.clear();
+  for (int i = 0; i < streams_.size(); i++) {
+    in_bufs_.push_back(&streambufs["in_stream_" + std::to_string(i)]);
+  }
+}
+
 void Mixer::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
+  if (in_bufs_.size() != streams_.size()) {
+    IndexStreams_();
+  }
+
   if (output.quantity() < output.capacity()) {
     double tgt_qty = output.space();
 
     for (int i = 0; i < mixing_ratios.size(); i++) {
-      std::string name = "in_stream_" + std::to_string(i);
-      tgt_qty =
-          std::min(tgt_qty, streambufs[name].quantity() / mixing_ratios[i]);
+      tgt_qty = std::min(tgt_qty, in_bufs_[i]->quantity() / mixing_ratios[i]);
     }
 
     tgt_qty = std::min(tgt_qty, throughput);
 
     if (tgt_qty > 0) {
-      cyclus::Material::Ptr m;
+      cyclus::toolkit::MatVec mats;
       for (int i = 0; i < mixing_ratios.size(); i++) {
-        std::string name = "in_stream_" + std::to_string(i);
         double pop_qty = mixing_ratios[i] * tgt_qty;
-        if (i == 0) {
-          m = streambufs[name].Pop(pop_qty, cyclus::eps_rsrc());
-        } else {
-          cyclus::Material::Ptr m_ =
-              streambufs[name].Pop(pop_qty, cyclus::eps_rsrc());
-          m->Absorb(m_);
-        }
+        mats.push_back(in_bufs_[i]->Pop(pop_qty, cyclus::eps_rsrc()));
       }
-      output.Push(m);
+      output.Push(Mix_(mats));
     }
   }
 }
 
+cyclus::Material::Ptr Mixer::Mix_(const cyclus::toolkit::MatVec& mats) {
+  if (!mix_single_comp) {
+    cyclus::Material::Ptr m = mats[0];
+    for (int i = 1; i < mats.size(); i++) {
+      m->Absorb(mats[i]);
+    }
+    return m;
+  }
+
+  std::vector<int> key;
+  for (int i = 0; i < mats.size(); i++) {
+    key.push_back(mats[i]->comp()->id());
+  }
+
+  // the mixing ratios are fixed, so the mixture only changes when one of the
+  // stream compositions does
+  if (key != mix_key_ || mix_comp_.get() == NULL) {
+    cyclus::CompMap mixed;
+    for (int i = 0; i < mats.size(); i++) {
+      cyclus::CompMap v = mats[i]->comp()->mass();
+      cyclus::compmath::Normalize(&v, mixing_ratios[i]);
+      mixed = cyclus::compmath::Add(mixed, v);
+    }
+    mix_comp_ = cyclus::Composition::CreateFromMass(mixed);
+    mix_key_ = key;
+  }
+
+  // the popped materials are still absorbed so the output keeps them as its
+  // parents, and then given the shared mixture composition
+  cyclus::Material::Ptr m = mats[0];
+  for (int i = 1; i < mats.size(); i++) {
+    m->Absorb(mats[i]);
+  }
+  m->Transmute(mix_comp_);
+  return m;
+}
+
+void Mixer::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+}
+
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Mixer::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<cyclus::Material>::Ptr> ports;
   
+  if (in_bufs_.size() != streams_.size()) {
+    IndexStreams_();
+  }
+
   for (int i = 0; i < in_commods.size(); i++) {
-    std::string name = "in_stream_" + std::to_string(i);
-    
-    if (streambufs[name].space() > cyclus::eps_rsrc()) {
+    if (in_bufs_[i]->space() > cyclus::eps_rsrc()) {
       RequestPortfolio<cyclus::Material>::Ptr port(
           new RequestPortfolio<cyclus::Material>());
 
       cyclus::Material::Ptr m;
-      m = cyclus::NewBlankMaterial(streambufs[name].space());
+      m = cyclus::NewBlankMaterial(in_bufs_[i]->space());
 
       std::vector<cyclus::Request<cyclus::Material>*> reqs;
       
@@ -142,18 +197,21 @@ Mixer::GetMatlRequests() {
         std::string commod = it->first;
         double pref = it->second;
         reqs.push_back(port->AddRequest(m, this, commod , pref, false));
-        req_inventories_[reqs.back()] = name;
+        req_inventories_[reqs.back()] = i;
       }
       port->AddMutualReqs(reqs);  
       ports.insert(port);
     }
   }
+  scope.Count(ArchetypePerf::NRequests<cyclus::Material>(ports));
   return ports;
 }
 
 void Mixer::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                                 cyclus::Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -161,21 +219,12 @@ void Mixer::AcceptMatlTrades(
     cyclus::Request<cyclus::Material>* req = trade->first.request;
     cyclus::Material::Ptr m = trade->second;
 
-    std::string name = req_inventories_[req];
-    bool assigned = false;
-    std::map<std::string, cyclus::toolkit::ResBuf<cyclus::Material> >::iterator
-        it;
-
-    for (it = streambufs.begin(); it != streambufs.end(); it++) {
-      if (name == it->first) {
-        it->second.Push(m);
-        assigned = true;
-        break;
-      }
-    }
-    if (!assigned) {
+    std::map<cyclus::Request<cyclus::Material>*, int>::iterator it =
+        req_inventories_.find(req);
+    if (it == req_inventories_.end()) {
       throw cyclus::ValueError("cycamore::Mixer was overmatched on requests");
     }
+    in_bufs_[it->second]->Push(m);
   }
 
   req_inventories_.clear();
@@ -4,6 +4,8 @@
 #include <string>
 #include "cycamore_version.h"
 #include "cyclus.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
 
 namespace cycamore {
 
@@ -12,7 +14,7 @@ namespace cycamore {
 /// one for each streams to be mixed, and one output stream. The supplying of
 /// mixed material is constrained by available inventory of mixed material
 /// quantities.
-class Mixer : public cyclus::Facility {
+class Mixer : public cyclus::Facility, public ConcurrentTimeListener {
 #pragma cyclus note {   	  \
     "niche": "mixing facility",				  \
     "doc": "Mixer mixes N streams with fixed, static, user-specified" \
@@ -23,13 +25,14 @@ class Mixer : public cyclus::Facility {
     }
 
   friend class MixerTest;
+  friend class CallbackBench;
 
  public:
   Mixer(cyclus::Context* ctx);
   virtual ~Mixer(){};
 
   virtual void Tick();
-  virtual void Tock(){};
+  virtual void Tock();
   virtual void EnterNotify();
 
   virtual void AcceptMatlTrades(
@@ -103,9 +106,50 @@ class Mixer : public cyclus::Facility {
   }
   double throughput;
 
+#pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "doc": "If true, each time step's mixed material is given the mixture " \
+           "composition, computed once and reused while the input stream " \
+           "compositions are unchanged, so that the outputs of successive " \
+           "time steps share one composition instead of each creating " \
+           "their own.", \
+    "uilabel": "Mix as Single Composition", \
+  }
+  bool mix_single_comp;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "doc": "If true, the wall time of each time step and exchange callback " \
+           "is recorded to the ArchetypePerf table every time step, with " \
+           "the number of requests or trades it handled.", \
+    "uilabel": "Record Performance", \
+  }
+  bool record_perf;
+
+  // per-phase timings for the current time step
+  ArchetypePerf perf_;
+
+  // input stream buffers by stream index - they point into streambufs, whose
+  // nodes are stable, and are (re)built by IndexStreams_
+  std::vector<cyclus::toolkit::ResBuf<cyclus::Material>*> in_bufs_;
+
+  /// points in_bufs_ at the streambufs entry of each input stream
+  void IndexStreams_();
+
+  /// combines the materials popped from each input stream (in stream order)
+  /// into the mixed output material
+  cyclus::Material::Ptr Mix_(const cyclus::toolkit::MatVec& mats);
+
+  // mixture composition cache for mix_single_comp, keyed on the composition
+  // ids of the materials popped from each stream
+  std::vector<int> mix_key_;
+  cyclus::Composition::Ptr mix_comp_;
+
   // intra-time-step state - no need to be a state var
-  // map<request, inventory name>
-  std::map<cyclus::Request<cyclus::Material>*, std::string> req_inventories_;
+  // map<request, input stream index>
+  std::map<cyclus::Request<cyclus::Material>*, int> req_inventories_;
 
   //// A policy for sending material
   cyclus::toolkit::MatlSellPolicy sell_policy;
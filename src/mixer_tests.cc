@@ -134,6 +134,8 @@ class MixerTest : public ::testing::Test {
     mf_facility_->in_buf_sizes = new_caps;
   }
 
+  void SetMixSingleComp(bool single) { mf_facility_->mix_single_comp = single; }
+
   void SetOutStream_comds(std::string com) {
     out_com = com;
     mf_facility_->out_commod = com;
@@ -170,6 +172,28 @@ class MixerTest : public ::testing::Test {
   }
 };
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Checking that a restart restores the output and stream inventories into the
+// buffers they were snapshotted from.
+TEST_F(MixerTest, RestoreInventories) {
+  using cyclus::Material;
+
+  std::vector<Material::Ptr> mats;
+  mats.push_back(Material::CreateUntracked(1, c_pustream()));
+  SetInputInv(mats);
+  GetOutPutBuffer()->Push(Material::CreateUntracked(2, c_pustream()));
+
+  cyclus::Inventories inv = mf_facility_->SnapshotInv();
+  delete mf_facility_;
+  mf_facility_ = new Mixer(tc_.get());
+  mf_facility_->InitInv(inv);
+
+  EXPECT_DOUBLE_EQ(2, GetOutPutBuffer()->quantity());
+  std::map<std::string, InvBuffer> bufs = GetStreamBuffer();
+  EXPECT_EQ(1, bufs.size());
+  EXPECT_DOUBLE_EQ(1, bufs["in_stream_0"].quantity());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // Checking that ratios correctly default to 1/N.
 TEST_F(MixerTest, StreamDefaultRatio) {
@@ -272,6 +296,53 @@ TEST_F(MixerTest, MixingComposition) {
   }
 }
 
+// Check that mixing as a single composition matches sequential absorption
+TEST_F(MixerTest, MixSingleComp) {
+  using cyclus::Material;
+
+  std::vector<double> in_frac_ = {0.80, 0.15, 0.05};
+  SetStream_ratio(in_frac_);
+  SetOutStream_capacity(50);
+  SetThroughput(1);
+  SetMixSingleComp(true);
+
+  std::vector<Material::Ptr> mat;
+  mat.push_back(Material::CreateUntracked(in_cap[0], c_natu()));
+  mat.push_back(Material::CreateUntracked(in_cap[1], c_pustream()));
+  mat.push_back(Material::CreateUntracked(in_cap[2], c_uox()));
+  SetInputInv(mat);
+
+  mf_facility_->Tick();
+  mf_facility_->Tick();
+
+  cyclus::CompMap v_0 = c_natu()->mass();
+  cyclus::compmath::Normalize(&v_0, in_frac_[0]);
+  cyclus::CompMap v_1 = c_pustream()->mass();
+  cyclus::compmath::Normalize(&v_1, in_frac_[1]);
+  cyclus::CompMap v_2 = c_uox()->mass();
+  cyclus::compmath::Normalize(&v_2, in_frac_[2]);
+  cyclus::CompMap v = cyclus::compmath::Add(v_0, v_1);
+  v = cyclus::compmath::Add(v, v_2);
+  cyclus::compmath::Normalize(&v, 1);
+
+  InvBuffer* buffer = GetOutPutBuffer();
+  ASSERT_EQ(2, buffer->count());
+  EXPECT_DOUBLE_EQ(2, buffer->quantity());
+  Material::Ptr second = cyclus::ResCast<Material>(buffer->PopBack());
+  Material::Ptr first = cyclus::ResCast<Material>(buffer->PopBack());
+
+  // unchanged stream compositions reuse the same mixture
+  EXPECT_EQ(first->comp(), second->comp());
+
+  cyclus::CompMap final_comp = first->comp()->mass();
+  cyclus::compmath::Normalize(&final_comp, 1);
+  cyclus::CompMap::iterator it;
+  for (it = v.begin(); it != v.end(); it++) {
+    EXPECT_NEAR(v[it->first], final_comp[it->first], 1e-12)
+        << "Unexpected difference on nuclide " << it->first << ".";
+  }
+}
+
 // Check the throughput constrain
 TEST_F(MixerTest, Throughput) {
   using cyclus::Material;
@@ -1,5 +1,8 @@
 #include "reactor.h"
 
+#include <algorithm>
+#include <cmath>
+
 using cyclus::Material;
 using cyclus::Composition;
 using cyclus::toolkit::ResBuf;
@@ -22,7 +25,20 @@ Reactor::Reactor(cyclus::Context* ctx)
       cycle_step(0),
       power_cap(0),
       power_name("power"),
-      discharged(false) { }
+      aggregate_requests(false),
+      aggregate_bids(false),
+      power_segments(false),
+      record_perf(false),
+      footprint_interval(0),
+      discharged(false),
+      n_spent_(0),
+      spent_qty_(0),
+      changes_compiled_(false),
+      change_cursor_(0),
+      wake_time_(0),
+      fuel_interned_(false),
+      power_seg_start(-1),
+      power_seg_value(0) { }
 
 #pragma cyclus def clone cycamore::Reactor
 
@@ -34,9 +50,41 @@ Reactor::Reactor(cyclus::Context* ctx)
 
 #pragma cyclus def snapshot cycamore::Reactor
 
-#pragma cyclus def snapshotinv cycamore::Reactor
+cyclus::Inventories Reactor::SnapshotInv() {
+  cyclus::Inventories invs;
+  invs["fresh"] = fresh.PopNRes(fresh.count());
+  fresh.Push(invs["fresh"]);
+  invs["core"] = core.PopNRes(core.count());
+  core.Push(invs["core"]);
+
+  std::vector<cyclus::Resource::Ptr>& spent_inv = invs["spent"];
+  for (int i = 0; i < spent_.size(); i++) {
+    spent_inv.insert(spent_inv.end(), spent_[i].begin(), spent_[i].end());
+  }
+  return invs;
+}
+
+void Reactor::InitInv(cyclus::Inventories& inv) {
+  InternFuel();
 
-#pragma cyclus def initinv cycamore::Reactor
+  std::vector<cyclus::Resource::Ptr>& fresh_inv = inv["fresh"];
+  fresh.Push(fresh_inv);
+  for (int i = 0; i < fresh_inv.size(); i++) {
+    fresh_slots_.push_back(fuel_slot(fresh_inv[i]));
+  }
+
+  std::vector<cyclus::Resource::Ptr>& core_inv = inv["core"];
+  core.Push(core_inv);
+  for (int i = 0; i < core_inv.size(); i++) {
+    core_slots_.push_back(fuel_slot(core_inv[i]));
+    core_mats_.push_back(cyclus::ResCast<Material>(core_inv[i]));
+  }
+
+  std::vector<cyclus::Resource::Ptr>& spent_inv = inv["spent"];
+  for (int i = 0; i < spent_inv.size(); i++) {
+    PushSpent(cyclus::ResCast<Material>(spent_inv[i]), fuel_slot(spent_inv[i]));
+  }
+}
 
 void Reactor::InitFrom(Reactor* m) {
   #pragma cyclus impl initfromcopy cycamore::Reactor
@@ -89,16 +137,31 @@ void Reactor::EnterNotify() {
        << " pref_change_values vals, expected " << n << "\n";
   }
 
+  for (int i = 0; i < ignored_events.size(); i++) {
+    int ev = 0;
+    while (ev < N_REACTOR_EVENTS &&
+           ignored_events[i] != ReactorEventName(static_cast<ReactorEvent>(ev))) {
+      ev++;
+    }
+    if (ev == N_REACTOR_EVENTS) {
+      ss << "prototype '" << prototype() << "' has invalid ignored_events val '"
+         << ignored_events[i] << "'\n";
+    }
+  }
+
   if (ss.str().size() > 0) {
     throw cyclus::ValueError(ss.str());
   }
+
+  CompileChanges();
 }
 
 bool Reactor::CheckDecommissionCondition() {
-  return core.count() == 0 && spent.count() == 0;
+  return core.count() == 0 && n_spent() == 0;
 }
 
 void Reactor::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
   // The following code must go in the Tick so they fire on the time step
   // following the cycle_step update - allowing for the all reactor events to
   // occur and be recorded on the "beginning" of a time step.  Another reason
@@ -106,18 +169,23 @@ void Reactor::Tick() {
   // can't go at the beginnin of the Tock is so that resource exchange has a
   // chance to occur after the discharge on this same time step.
 
+  if (context()->time() < wake_time_) {
+    return;  // mid-cycle with nothing scheduled
+  }
+
   if (retired()) {
-    Record("RETIRED", "");
+    Record(EVENT_RETIRED);
 
     // record the last time series entry if the reactor was operating at the
     // time of retirement.
     if (exit_time() == context()->time()) {
       if (cycle_step > 0 && cycle_step <= cycle_time &&
           core.count() == n_assem_core) {
-        cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, power_cap);
+        RecordPower(power_cap);
       } else {
-        cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, 0);
+        RecordPower(0);
       }
+      ClosePowerSegment(context()->time());
     }
 
     if (context()->time() == exit_time()) { // only need to transmute once
@@ -131,15 +199,16 @@ void Reactor::Tick() {
     // in case a cycle lands exactly on our last time step, we will need to
     // burn a batch from fresh inventory on this time step.  When retired,
     // this batch also needs to be discharged to spent fuel inventory.
-    while (fresh.count() > 0 && spent.space() >= assem_size) {
-      spent.Push(fresh.Pop());
+    while (fresh.count() > 0 && spent_space() >= assem_size) {
+      PushSpent(fresh.Pop(), fresh_slots_.front());
+      fresh_slots_.pop_front();
     }
     return;
   }
 
   if (cycle_step == cycle_time) {
     Transmute();
-    Record("CYCLE_END", "");
+    Record(EVENT_CYCLE_END);
   }
 
   if (cycle_step >= cycle_time && !discharged) {
@@ -149,47 +218,76 @@ void Reactor::Tick() {
     Load();
   }
 
-  int t = context()->time();
+  ApplyChanges(context()->time());
+}
 
-  // update preferences
+void Reactor::CompileChanges() {
+  if (changes_compiled_) {
+    return;
+  }
+  changes_compiled_ = true;
+
+  // first match wins, same as a linear scan of fuel_incommods
+  std::map<std::string, int> slots;
+  for (int i = 0; i < fuel_incommods.size(); i++) {
+    slots.insert(std::make_pair(fuel_incommods[i], i));
+  }
+
+  // pref changes are added first so they are applied before recipe changes
+  // at the same time step.
+  std::map<std::string, int>::iterator it;
   for (int i = 0; i < pref_change_times.size(); i++) {
-    int change_t = pref_change_times[i];
-    if (t != change_t) {
+    it = slots.find(pref_change_commods[i]);
+    if (it == slots.end()) {
       continue;
     }
-
-    std::string incommod = pref_change_commods[i];
-    for (int j = 0; j < fuel_incommods.size(); j++) {
-      if (fuel_incommods[j] == incommod) {
-        fuel_prefs[j] = pref_change_values[i];
-        break;
-      }
-    }
+    FuelChange c = {pref_change_times[i], it->second, i, false};
+    fuel_changes_.push_back(c);
   }
-
-  // update recipes
   for (int i = 0; i < recipe_change_times.size(); i++) {
-    int change_t = recipe_change_times[i];
-    if (t != change_t) {
+    it = slots.find(recipe_change_commods[i]);
+    if (it == slots.end()) {
       continue;
     }
+    FuelChange c = {recipe_change_times[i], it->second, i, true};
+    fuel_changes_.push_back(c);
+  }
+  std::stable_sort(fuel_changes_.begin(), fuel_changes_.end());
 
-    std::string incommod = recipe_change_commods[i];
-    for (int j = 0; j < fuel_incommods.size(); j++) {
-      if (fuel_incommods[j] == incommod) {
-        fuel_inrecipes[j] = recipe_change_in[i];
-        fuel_outrecipes[j] = recipe_change_out[i];
-        break;
-      }
+  // changes before now were applied before any snapshot we restarted from
+  int t = context()->time();
+  change_cursor_ = 0;
+  while (change_cursor_ < fuel_changes_.size() &&
+         fuel_changes_[change_cursor_].time < t) {
+    change_cursor_++;
+  }
+}
+
+void Reactor::ApplyChanges(int t) {
+  CompileChanges();
+  while (change_cursor_ < fuel_changes_.size() &&
+         fuel_changes_[change_cursor_].time < t) {
+    change_cursor_++;
+  }
+
+  while (change_cursor_ < fuel_changes_.size() &&
+         fuel_changes_[change_cursor_].time == t) {
+    const FuelChange& c = fuel_changes_[change_cursor_];
+    if (c.recipe) {
+      fuel_inrecipes[c.slot] = recipe_change_in[c.index];
+      fuel_outrecipes[c.slot] = recipe_change_out[c.index];
+    } else {
+      fuel_prefs[c.slot] = pref_change_values[c.index];
     }
+    change_cursor_++;
   }
 }
 
 std::set<cyclus::RequestPortfolio<Material>::Ptr> Reactor::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<Material>::Ptr> ports;
-  Material::Ptr m;
 
   // second min expression reduces assembles to amount needed until
   // retirement if it is near.
@@ -213,21 +311,51 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> Reactor::GetMatlRequests() {
     return ports;
   }
 
-  for (int i = 0; i < n_assem_order; i++) {
+  // each request is for n assemblies - one per assembly unless aggregating
+  std::vector<int> sizes;
+  if (aggregate_requests) {
+    int n_left = n_assem_order;
+    while (n_left > 0) {
+      int n = 1;
+      while (2 * n <= n_left) {
+        n *= 2;
+      }
+      sizes.push_back(n);
+      n_left -= n;
+    }
+  } else {
+    sizes.resize(n_assem_order, 1);
+  }
+
+  std::vector<Composition::Ptr> recipes;
+  for (int j = 0; j < fuel_incommods.size(); j++) {
+    recipes.push_back(inrecipes_.Get(context(), fuel_inrecipes, j));
+  }
+
+  // target materials are shared between equally sized requests
+  std::map<int, std::vector<Material::Ptr> > targets;
+  for (int i = 0; i < sizes.size(); i++) {
+    std::vector<Material::Ptr>& mats = targets[sizes[i]];
+    if (mats.empty()) {
+      for (int j = 0; j < fuel_incommods.size(); j++) {
+        mats.push_back(
+            Material::CreateUntracked(sizes[i] * assem_size, recipes[j]));
+      }
+    }
+
     RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
     std::vector<Request<Material>*> mreqs;
     for (int j = 0; j < fuel_incommods.size(); j++) {
       std::string commod = fuel_incommods[j];
       double pref = fuel_prefs[j];
-      Composition::Ptr recipe = context()->GetRecipe(fuel_inrecipes[j]);
-      m = Material::CreateUntracked(assem_size, recipe);
-      Request<Material>* r = port->AddRequest(m, this, commod, pref, true);
+      Request<Material>* r = port->AddRequest(mats[j], this, commod, pref, true);
       mreqs.push_back(r);
     }
     port->AddMutualReqs(mreqs);
     ports.insert(port);
   }
 
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
   return ports;
 }
 
@@ -235,76 +363,117 @@ void Reactor::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
   using cyclus::Trade;
 
-  std::map<std::string, MatVec> mats = PopSpent();
+  InternFuel();
   for (int i = 0; i < trades.size(); i++) {
     std::string commod = trades[i].request->commodity();
-    Material::Ptr m = mats[commod].back();
-    mats[commod].pop_back();
-    responses.push_back(std::make_pair(trades[i], m));
+    std::map<std::string, int>::iterator it = outcommod_ids_.find(commod);
+    if (it == outcommod_ids_.end()) {
+      throw ValueError("cycamore::Reactor - no spent fuel offered on " +
+                       commod);
+    }
+
+    if (!aggregate_bids) {
+      Material::Ptr m = PopSpent(it->second);
+      responses.push_back(std::make_pair(trades[i], m));
+      res_indexes.erase(m->obj_id());
+      continue;
+    }
+
+    // split aggregated bids back into the whole assemblies they represent
+    int comp_id = trades[i].bid->offer()->comp()->id();
+    int n = std::max(1, static_cast<int>(
+                            std::floor(trades[i].amt / assem_size + 0.5)));
+    if (n > CountSpent(it->second, comp_id)) {
+      throw ValueError("cycamore::Reactor - too few spent assemblies of the "
+                       "traded composition offered on " + commod);
+    }
+    Material::Ptr m = PopSpent(it->second, comp_id);
     res_indexes.erase(m->obj_id());
+    for (int j = 1; j < n; j++) {
+      Material::Ptr assem = PopSpent(it->second, comp_id);
+      res_indexes.erase(assem->obj_id());
+      m->Absorb(assem);
+    }
+    responses.push_back(std::make_pair(trades[i], m));
   }
-  PushSpent(mats);  // return leftovers back to spent buffer
 }
 
 void Reactor::AcceptMatlTrades(const std::vector<
     std::pair<cyclus::Trade<Material>, Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
-  std::stringstream ss;
-  int nload = std::min((int)responses.size(), n_assem_core - core.count());
-  if (nload > 0) {
-    ss << nload << " assemblies";
-    Record("LOAD", ss.str());
-  }
-
+  // split aggregated (multi-assembly) trades back into single assemblies
+  std::vector<std::pair<std::string, Material::Ptr> > assems;
   for (trade = responses.begin(); trade != responses.end(); ++trade) {
     std::string commod = trade->first.request->commodity();
     Material::Ptr m = trade->second;
-    index_res(m, commod);
+    int n = static_cast<int>(m->quantity() / assem_size + 0.5);
+    for (int i = 1; i < n; i++) {
+      assems.push_back(std::make_pair(commod, m->ExtractQty(assem_size)));
+    }
+    assems.push_back(std::make_pair(commod, m));
+  }
+
+  int nload = std::min((int)assems.size(), n_assem_core - core.count());
+  if (nload > 0) {
+    Record(EVENT_LOAD, nload);
+  }
+
+  for (int i = 0; i < assems.size(); i++) {
+    Material::Ptr m = assems[i].second;
+    int slot = index_res(m, assems[i].first);
 
     if (core.count() < n_assem_core) {
       core.Push(m);
+      core_slots_.push_back(slot);
+      core_mats_.push_back(m);
     } else {
       fresh.Push(m);
+      fresh_slots_.push_back(slot);
     }
   }
 }
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> Reactor::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
   using cyclus::BidPortfolio;
 
   std::set<BidPortfolio<Material>::Ptr> ports;
-
-  bool gotmats = false;
-  std::map<std::string, MatVec> all_mats;
-
-  if (uniq_outcommods_.empty()) {
-    for (int i = 0; i < fuel_outcommods.size(); i++) {
-      uniq_outcommods_.insert(fuel_outcommods[i]);
-    }
+  if (n_spent() == 0) {
+    return ports;
   }
 
-  std::set<std::string>::iterator it;
-  for (it = uniq_outcommods_.begin(); it != uniq_outcommods_.end(); ++it) {
-    std::string commod = *it;
+  InternFuel();
+  for (int i = 0; i < outcommods_.size(); i++) {
+    const std::string& commod = outcommods_[i];
     std::vector<Request<Material>*>& reqs = commod_requests[commod];
     if (reqs.size() == 0) {
       continue;
-    } else if (!gotmats) {
-      all_mats = PeekSpent();
     }
 
-    MatVec mats = all_mats[commod];
+    const std::deque<Material::Ptr>& mats = spent_[i];
     if (mats.size() == 0) {
       continue;
     }
 
     BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
 
+    if (aggregate_bids) {
+      AddAggregateBids(port, reqs, mats);
+      cyclus::CapacityConstraint<Material> cc(spent_qtys_[i]);
+      port->AddConstraint(cc);
+      ports.insert(port);
+      continue;
+    }
+
     for (int j = 0; j < reqs.size(); j++) {
       Request<Material>* req = reqs[j];
       double tot_bid = 0;
@@ -318,20 +487,67 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> Reactor::GetMatlBids(
       }
     }
 
-    double tot_qty = 0;
-    for (int j = 0; j < mats.size(); j++) {
-      tot_qty += mats[j]->quantity();
-    }
-    cyclus::CapacityConstraint<Material> cc(tot_qty);
+    cyclus::CapacityConstraint<Material> cc(spent_qtys_[i]);
     port->AddConstraint(cc);
     ports.insert(port);
   }
 
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
   return ports;
 }
 
+void Reactor::AddAggregateBids(
+    cyclus::BidPortfolio<Material>::Ptr port,
+    const std::vector<Request<Material>*>& reqs,
+    const std::deque<Material::Ptr>& mats) {
+  // group assemblies by composition, oldest compositions first
+  std::vector<Composition::Ptr> comps;
+  std::map<int, int> counts;
+  for (int k = 0; k < mats.size(); k++) {
+    Composition::Ptr c = mats[k]->comp();
+    if (counts[c->id()]++ == 0) {
+      comps.push_back(c);
+    }
+  }
+
+  for (int j = 0; j < reqs.size(); j++) {
+    Request<Material>* req = reqs[j];
+    // as with per-assembly bids, never offer a partial assembly
+    double want = std::floor(req->target()->quantity() / assem_size +
+                             cyclus::eps_rsrc());
+    want = std::max(want, 1.0);
+    for (int k = 0; k < comps.size(); k++) {
+      int n = counts[comps[k]->id()];
+      if (want < n) {
+        n = static_cast<int>(want);
+      }
+      Material::Ptr offer =
+          Material::CreateUntracked(n * assem_size, comps[k]);
+      port->AddBid(req, offer, this, true);
+    }
+  }
+
+  for (int k = 0; k < comps.size(); k++) {
+    int comp_id = comps[k]->id();
+    cyclus::Converter<Material>::Ptr conv(new SpentCompConverter(comp_id));
+    cyclus::CapacityConstraint<Material> cc(counts[comp_id] * assem_size,
+                                            conv);
+    port->AddConstraint(cc);
+  }
+}
+
 void Reactor::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  RecordFootprint_();
   if (retired()) {
+    FlushEvents();
+    return;
+  }
+
+  if (context()->time() < wake_time_) {
+    RecordPower(power_cap);
+    cycle_step++;
+    FlushEvents();
     return;
   }
 
@@ -341,14 +557,14 @@ void Reactor::Tock() {
   }
 
   if (cycle_step == 0 && core.count() == n_assem_core) {
-    Record("CYCLE_START", "");
+    Record(EVENT_CYCLE_START);
   }
 
   if (cycle_step >= 0 && cycle_step < cycle_time &&
       core.count() == n_assem_core) {
-    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, power_cap);
+    RecordPower(power_cap);
   } else {
-    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, 0);
+    RecordPower(0);
   }
 
   // "if" prevents starting cycle after initial deployment until core is full
@@ -356,50 +572,67 @@ void Reactor::Tock() {
   if (cycle_step > 0 || core.count() == n_assem_core) {
     cycle_step++;
   }
-}
 
-void Reactor::Transmute() { Transmute(n_assem_batch); }
+  wake_time_ = NextEventTime();
+  FlushEvents();
+}
 
-void Reactor::Transmute(int n_assem) {
-  MatVec old = core.PopN(std::min(n_assem, core.count()));
-  core.Push(old);
-  if (core.count() > old.size()) {
-    // rotate untransmuted mats back to back of buffer
-    core.Push(core.PopN(core.count() - old.size()));
+int Reactor::NextEventTime() {
+  int t = context()->time();
+  if (retired() || core.count() < n_assem_core || cycle_step == 0 ||
+      cycle_step >= cycle_time) {
+    return t + 1;
   }
 
-  std::stringstream ss;
-  ss << old.size() << " assemblies";
-  Record("TRANSMUTE", ss.str());
-
-  for (int i = 0; i < old.size(); i++) {
-    old[i]->Transmute(context()->GetRecipe(fuel_outrecipe(old[i])));
+  // Tick ends the cycle on the step it sees cycle_step == cycle_time
+  int next = t + cycle_time - cycle_step + 1;
+  if (exit_time() != -1) {
+    next = std::min(next, exit_time());
   }
+  CompileChanges();
+  if (change_cursor_ < fuel_changes_.size()) {
+    next = std::min(next, fuel_changes_[change_cursor_].time);
+  }
+  return std::max(next, t + 1);
 }
 
-std::map<std::string, MatVec> Reactor::PeekSpent() {
-  std::map<std::string, MatVec> mapped;
-  MatVec mats = spent.PopN(spent.count());
-  spent.Push(mats);
-  for (int i = 0; i < mats.size(); i++) {
-    std::string commod = fuel_outcommod(mats[i]);
-    mapped[commod].push_back(mats[i]);
+void Reactor::Transmute() { Transmute(n_assem_batch); }
+
+void Reactor::Transmute(int n_assem) {
+  int n = std::min(n_assem, core.count());
+  Record(EVENT_TRANSMUTE, n);
+
+  // transmute the assemblies at the front of the core in place, resolving
+  // each fuel slot's outrecipe once for the whole batch so assemblies of the
+  // same fuel share one composition
+  std::vector<Composition::Ptr> comps(fuel_outrecipes.size());
+  for (int i = 0; i < n; i++) {
+    int slot = core_slots_[i];
+    if (slot >= comps.size()) {
+      throw KeyError("cycamore::Reactor - no outrecipe for material object");
+    }
+    if (comps[slot].get() == NULL) {
+      comps[slot] = outrecipes_.Get(context(), fuel_outrecipes, slot);
+    }
+    core_mats_[i]->Transmute(comps[slot]);
   }
-  return mapped;
 }
 
 bool Reactor::Discharge() {
   int npop = std::min(n_assem_batch, core.count());
-  if (n_assem_spent - spent.count() < npop) {
-    Record("DISCHARGE", "failed");
+  if (n_assem_spent - n_spent() < npop) {
+    Record(EVENT_DISCHARGE_FAILED, npop);
     return false;  // not enough room in spent buffer
   }
 
-  std::stringstream ss;
-  ss << npop << " assemblies";
-  Record("DISCHARGE", ss.str());
+  Record(EVENT_DISCHARGE, npop);
 
-  spent.Push(core.PopN(npop));
+  MatVec old = core.PopN(npop);
+  for (int i = 0; i < old.size(); i++) {
+    PushSpent(old[i], core_slots_.front());
+    core_slots_.pop_front();
+    core_mats_.pop_front();
+  }
   return true;
 }
 
@@ -409,97 +642,230 @@ void Reactor::Load() {
     return;
   }
 
-  std::stringstream ss;
-  ss << n << " assemblies";
-  Record("LOAD", ss.str());
-  core.Push(fresh.PopN(n));
+  Record(EVENT_LOAD, n);
+  MatVec mats = fresh.PopN(n);
+  core.Push(mats);
+  core_mats_.insert(core_mats_.end(), mats.begin(), mats.end());
+  core_slots_.insert(core_slots_.end(), fresh_slots_.begin(),
+                     fresh_slots_.begin() + n);
+  fresh_slots_.erase(fresh_slots_.begin(), fresh_slots_.begin() + n);
 }
 
-std::string Reactor::fuel_incommod(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
-  if (i >= fuel_incommods.size()) {
-    throw KeyError("cycamore::Reactor - no incommod for material object");
+int Reactor::fuel_slot(cyclus::Resource::Ptr m) {
+  std::map<int, int>::iterator it = res_indexes.find(m->obj_id());
+  if (it == res_indexes.end() || it->second >= fuel_incommods.size()) {
+    throw KeyError("cycamore::Reactor - no fuel index for material object");
   }
-  return fuel_incommods[i];
+  return it->second;
 }
 
-std::string Reactor::fuel_outcommod(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
-  if (i >= fuel_outcommods.size()) {
+void Reactor::InternFuel() {
+  if (fuel_interned_) {
+    return;
+  }
+  fuel_interned_ = true;
+
+  std::set<std::string> uniq(fuel_outcommods.begin(), fuel_outcommods.end());
+  outcommods_.assign(uniq.begin(), uniq.end());
+  for (int i = 0; i < outcommods_.size(); i++) {
+    outcommod_ids_[outcommods_[i]] = i;
+  }
+
+  for (int i = 0; i < fuel_incommods.size(); i++) {
+    // first match wins, same as a linear scan of fuel_incommods
+    incommod_slots_.insert(std::make_pair(fuel_incommods[i], i));
+    if (i < fuel_outcommods.size()) {
+      slot_outcommods_.push_back(outcommod_ids_[fuel_outcommods[i]]);
+    } else {
+      slot_outcommods_.push_back(-1);
+    }
+  }
+
+  spent_.resize(outcommods_.size());
+  spent_qtys_.resize(outcommods_.size(), 0);
+}
+
+int Reactor::index_res(cyclus::Resource::Ptr m, std::string incommod) {
+  InternFuel();
+  std::map<std::string, int>::iterator it = incommod_slots_.find(incommod);
+  if (it == incommod_slots_.end()) {
+    throw ValueError(
+        "cycamore::Reactor - received unsupported incommod material");
+  }
+  res_indexes[m->obj_id()] = it->second;
+  return it->second;
+}
+
+void Reactor::PushSpent(Material::Ptr m, int slot) {
+  InternFuel();
+  int commod = slot_outcommods_[slot];
+  if (commod < 0) {
     throw KeyError("cycamore::Reactor - no outcommod for material object");
   }
-  return fuel_outcommods[i];
+  spent_[commod].push_back(m);
+  spent_qtys_[commod] += m->quantity();
+  spent_qty_ += m->quantity();
+  n_spent_++;
 }
 
-std::string Reactor::fuel_inrecipe(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
-  if (i >= fuel_inrecipes.size()) {
-    throw KeyError("cycamore::Reactor - no inrecipe for material object");
+int Reactor::CountSpent(int outcommod, int comp_id) {
+  const std::deque<Material::Ptr>& mats = spent_[outcommod];
+  int n = 0;
+  for (int i = 0; i < mats.size(); i++) {
+    if (mats[i]->comp()->id() == comp_id) {
+      n++;
+    }
   }
-  return fuel_inrecipes[i];
+  return n;
 }
 
-std::string Reactor::fuel_outrecipe(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
-  if (i >= fuel_outrecipes.size()) {
-    throw KeyError("cycamore::Reactor - no outrecipe for material object");
+Material::Ptr Reactor::PopSpent(int outcommod, int comp_id) {
+  std::deque<Material::Ptr>& mats = spent_[outcommod];
+  if (mats.empty()) {
+    throw ValueError("cycamore::Reactor - no spent fuel offered on " +
+                     outcommods_[outcommod]);
+  }
+
+  // oldest assemblies are traded away first
+  int pos = 0;
+  if (comp_id >= 0) {
+    while (pos < mats.size() && mats[pos]->comp()->id() != comp_id) {
+      pos++;
+    }
+    if (pos == mats.size()) {
+      throw ValueError("cycamore::Reactor - no spent fuel of the traded "
+                       "composition offered on " + outcommods_[outcommod]);
+    }
+  }
+  Material::Ptr m = mats[pos];
+  mats.erase(mats.begin() + pos);
+  spent_qtys_[outcommod] -= m->quantity();
+  spent_qty_ -= m->quantity();
+  n_spent_--;
+
+  // avoid drift from accumulated floating point error
+  if (mats.empty()) {
+    spent_qtys_[outcommod] = 0;
+  }
+  if (n_spent_ == 0) {
+    spent_qty_ = 0;
   }
-  return fuel_outrecipes[i];
+  return m;
 }
 
-double Reactor::fuel_pref(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
-  if (i >= fuel_prefs.size()) {
-    return 0;
+void Reactor::Record(ReactorEvent ev, int n) {
+  if (recorded(ev)) {
+    events_.push_back(std::make_pair(ev, n));
   }
-  return fuel_prefs[i];
 }
 
-void Reactor::index_res(cyclus::Resource::Ptr m, std::string incommod) {
-  for (int i = 0; i < fuel_incommods.size(); i++) {
-    if (fuel_incommods[i] == incommod) {
-      res_indexes[m->obj_id()] = i;
-      return;
+void Reactor::FlushEvents() {
+  if (events_.empty()) {
+    return;
+  }
+  std::vector<std::pair<ReactorEvent, int> > events;
+  events.swap(events_);
+  datum_stage_.Write([this, events]() {
+    for (int i = 0; i < events.size(); i++) {
+      context()
+          ->NewDatum("ReactorEvents")
+          ->AddVal("AgentId", id())
+          ->AddVal("Time", context()->time())
+          ->AddVal("Event", std::string(ReactorEventName(events[i].first)))
+          ->AddVal("Value", events[i].second)
+          ->Record();
     }
+  });
+}
+
+void Reactor::RecordFootprint_() {
+  if (!InventoryFootprint::Due(footprint_interval, context()->time())) {
+    return;
+  }
+  MatVec spent;
+  for (int i = 0; i < spent_.size(); i++) {
+    spent.insert(spent.end(), spent_[i].begin(), spent_[i].end());
   }
-  throw ValueError(
-      "cycamore::Reactor - received unsupported incommod material");
+  InventoryFootprint fp;
+  fp.AddBuf("fresh", &fresh);
+  fp.AddBuf("core", &core);
+  fp.Add("spent", spent);
+  fp.Record(this);
 }
 
-std::map<std::string, MatVec> Reactor::PopSpent() {
-  MatVec mats = spent.PopN(spent.count());
-  std::map<std::string, MatVec> mapped;
-  for (int i = 0; i < mats.size(); i++) {
-    std::string commod = fuel_outcommod(mats[i]);
-    mapped[commod].push_back(mats[i]);
+void Reactor::RecordPower(double power) {
+  if (!power_segments) {
+    datum_stage_.Write([this, power]() {
+      cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, power);
+    });
+    return;
   }
 
-  // needed so we trade away oldest assemblies first
-  std::map<std::string, MatVec>::iterator it;
-  for (it = mapped.begin(); it != mapped.end(); ++it) {
-    std::reverse(it->second.begin(), it->second.end());
+  int t = context()->time();
+  if (power_seg_start != -1 && power != power_seg_value) {
+    ClosePowerSegment(t - 1);
   }
+  if (power_seg_start == -1) {
+    power_seg_start = t;
+    power_seg_value = power;
+  }
+  // agents are not notified when the simulation ends
+  if (t == context()->sim_info().duration - 1) {
+    ClosePowerSegment(t);
+  }
+}
 
-  return mapped;
+void Reactor::ClosePowerSegment(int end) {
+  if (power_seg_start == -1) {
+    return;
+  }
+  int start = power_seg_start;
+  double value = power_seg_value;
+  power_seg_start = -1;
+  datum_stage_.Write([this, start, end, value]() {
+    context()
+        ->NewDatum("ReactorPowerSegments")
+        ->AddVal("AgentId", id())
+        ->AddVal("StartTime", start)
+        ->AddVal("EndTime", end)
+        ->AddVal("Value", value)
+        ->Record();
+  });
 }
 
-void Reactor::PushSpent(std::map<std::string, MatVec> leftover) {
-  std::map<std::string, MatVec>::iterator it;
-  for (it = leftover.begin(); it != leftover.end(); ++it) {
-    // undo reverse in PopSpent to make sure oldest assemblies come out first
-    std::reverse(it->second.begin(), it->second.end());
-    spent.Push(it->second);
+bool Reactor::recorded(ReactorEvent ev) {
+  if (event_mask_.empty()) {
+    event_mask_.resize(N_REACTOR_EVENTS, true);
+    for (int i = 0; i < ignored_events.size(); i++) {
+      for (int j = 0; j < N_REACTOR_EVENTS; j++) {
+        if (ignored_events[i] == ReactorEventName(static_cast<ReactorEvent>(j))) {
+          event_mask_[j] = false;
+        }
+      }
+    }
   }
+  return event_mask_[ev];
 }
 
-void Reactor::Record(std::string name, std::string val) {
-  context()
-      ->NewDatum("ReactorEvents")
-      ->AddVal("AgentId", id())
-      ->AddVal("Time", context()->time())
-      ->AddVal("Event", name)
-      ->AddVal("Value", val)
-      ->Record();
+const char* ReactorEventName(ReactorEvent ev) {
+  switch (ev) {
+    case EVENT_CYCLE_START:
+      return "CYCLE_START";
+    case EVENT_CYCLE_END:
+      return "CYCLE_END";
+    case EVENT_LOAD:
+      return "LOAD";
+    case EVENT_DISCHARGE:
+      return "DISCHARGE";
+    case EVENT_DISCHARGE_FAILED:
+      return "DISCHARGE_FAILED";
+    case EVENT_TRANSMUTE:
+      return "TRANSMUTE";
+    case EVENT_RETIRED:
+      return "RETIRED";
+    default:
+      throw ValueError("cycamore::Reactor - invalid reactor event");
+  }
 }
 
 extern "C" cyclus::Agent* ConstructReactor(cyclus::Context* ctx) {
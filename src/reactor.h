@@ -1,11 +1,63 @@
 #ifndef CYCAMORE_SRC_REACTOR_H_
 #define CYCAMORE_SRC_REACTOR_H_
 
+#include <deque>
+#include <vector>
+
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "inventory_footprint.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
+/// Event types recorded by the Reactor to the ReactorEvents table.
+enum ReactorEvent {
+  EVENT_CYCLE_START = 0,
+  EVENT_CYCLE_END,
+  EVENT_LOAD,
+  EVENT_DISCHARGE,
+  EVENT_DISCHARGE_FAILED,
+  EVENT_TRANSMUTE,
+  EVENT_RETIRED,
+  N_REACTOR_EVENTS,
+};
+
+/// Returns the name recorded in the ReactorEvents Event column for ev.
+const char* ReactorEventName(ReactorEvent ev);
+
+/// A scheduled fuel preference or recipe change with its fuel slot already
+/// resolved.  Index refers to the pref_change_* or recipe_change_* vectors.
+struct FuelChange {
+  int time;
+  int slot;
+  int index;
+  bool recipe;
+
+  bool operator<(const FuelChange& other) const { return time < other.time; }
+};
+
+/// Limits the quantity of aggregated spent fuel bids of a single composition
+/// to the spent assemblies available with that composition.
+class SpentCompConverter : public cyclus::Converter<cyclus::Material> {
+ public:
+  SpentCompConverter(int comp_id) : comp_id_(comp_id) {}
+
+  virtual ~SpentCompConverter() {}
+
+  virtual double convert(
+      cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
+      cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
+          NULL) const {
+    return m->comp()->id() == comp_id_ ? m->quantity() : 0;
+  }
+
+ private:
+  int comp_id_;
+};
+
 /// Reactor is a simple, general reactor based on static compositional
 /// transformations to model fuel burnup.  The user specifies a set of input
 /// fuels and corresponding burnt compositions that fuel is transformed to when
@@ -53,7 +105,8 @@ namespace cycamore {
 /// compositions.
 
 class Reactor : public cyclus::Facility,
-  public cyclus::toolkit::CommodityProducer {
+  public cyclus::toolkit::CommodityProducer,
+  public ConcurrentTimeListener {
 #pragma cyclus note { \
 "niche": "reactor", \
 "doc": \
@@ -130,21 +183,45 @@ class Reactor : public cyclus::Facility,
       std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                             cyclus::Material::Ptr> >& responses);
 
-  #pragma cyclus decl
+  /// Returns the earliest time step after the current one at which Tick or
+  /// Tock can change the reactor's state (end a cycle, apply a scheduled pref
+  /// or recipe change, or retire).  Until then the reactor only burns fuel
+  /// and records power.  Only meaningful after the current time step's Tock.
+  int NextEventTime();
+
+  #pragma cyclus decl clone
+  #pragma cyclus decl initfromcopy
+  #pragma cyclus decl initfromdb
+  #pragma cyclus decl infiletodb
+  #pragma cyclus decl schema
+  #pragma cyclus decl annotations
+  #pragma cyclus decl snapshot
+  // the following pragmas are ommitted and the functions are written
+  // manually in order to handle the per-outcommod spent fuel queues:
+  //
+  //     #pragma cyclus decl snapshotinv
+  //     #pragma cyclus decl initinv
+
+  virtual cyclus::Inventories SnapshotInv();
+  virtual void InitInv(cyclus::Inventories& inv);
 
  private:
-  std::string fuel_incommod(cyclus::Material::Ptr m);
-  std::string fuel_outcommod(cyclus::Material::Ptr m);
-  std::string fuel_inrecipe(cyclus::Material::Ptr m);
-  std::string fuel_outrecipe(cyclus::Material::Ptr m);
-  double fuel_pref(cyclus::Material::Ptr m);
+  /// Returns the fuel slot (index into the fuel_* vectors) for the incommod
+  /// through which the given material was received.
+  int fuel_slot(cyclus::Resource::Ptr m);
+
+  /// Interns commodity names as small integer ids so assemblies can be
+  /// tracked by fuel slot instead of by name.  Does nothing after the first
+  /// call.
+  void InternFuel();
 
   bool retired() {
     return exit_time() != -1 && context()->time() >= exit_time();
   }
 
   /// Store fuel info index for the given resource received on incommod.
-  void index_res(cyclus::Resource::Ptr m, std::string incommod);
+  /// Returns the fuel slot.
+  int index_res(cyclus::Resource::Ptr m, std::string incommod);
 
   /// Discharge a batch from the core if there is room in the spent fuel
   /// inventory.  Returns true if a batch was successfully discharged.
@@ -161,20 +238,60 @@ class Reactor : public cyclus::Facility,
   /// fully burnt state as defined by their outrecipe.
   void Transmute(int n_assem);
 
-  /// Records a reactor event to the output db with the given name and note val.
-  void Record(std::string name, std::string val);
+  /// Buffers a reactor event involving n assemblies; buffered events are
+  /// written to the output db by FlushEvents.
+  void Record(ReactorEvent ev, int n = 0);
+
+  /// Records all buffered reactor events to the ReactorEvents table through
+  /// the datum stage.  Called once at the end of every time step.
+  void FlushEvents();
+
+  /// Records the reactor's power for the current time step through the datum
+  /// stage.  With power_segments, only extends or closes the open segment.
+  void RecordPower(double power);
+
+  /// Writes the open power segment, ending at time step end, to the
+  /// ReactorPowerSegments table through the datum stage.  Does nothing if no
+  /// segment is open.
+  void ClosePowerSegment(int end);
+
+  /// Compiles the pref and recipe change schedules into a time-sorted list
+  /// and positions the cursor at the first change at or after the current
+  /// time.  Does nothing after the first call.
+  void CompileChanges();
+
+  /// Applies all scheduled pref and recipe changes at time t.
+  void ApplyChanges(int t);
 
-  /// Complement of PopSpent - must be called with all materials passed that
-  /// were not traded away to other agents.
-  void PushSpent(std::map<std::string, cyclus::toolkit::MatVec> leftover);
+  /// Returns false if events of type ev are excluded by ignored_events.
+  bool recorded(ReactorEvent ev);
 
-  /// Returns all spent assemblies indexed by outcommod - removing them from
-  /// the spent fuel buffer.
-  std::map<std::string, cyclus::toolkit::MatVec> PopSpent();
+  /// Adds an assembly received through the given fuel slot to the back of
+  /// the spent fuel queue for its outcommod.
+  void PushSpent(cyclus::Material::Ptr m, int slot);
 
-  /// Returns all spent assemblies indexed by outcommod without removing them
-  /// from the spent fuel buffer.
-  std::map<std::string, cyclus::toolkit::MatVec> PeekSpent();
+  /// Returns the number of spent assemblies with composition comp_id offered
+  /// on the outcommod with the given interned id.
+  int CountSpent(int outcommod, int comp_id);
+
+  /// Removes and returns the oldest spent assembly offered on the outcommod
+  /// with the given interned id.  If comp_id is not negative, the oldest
+  /// assembly with that composition is taken, and it is an error if there is
+  /// none.
+  cyclus::Material::Ptr PopSpent(int outcommod, int comp_id = -1);
+
+  /// Adds one bid per spent fuel composition to each request, each offering
+  /// as many whole assemblies of that composition as the request can hold.
+  void AddAggregateBids(
+      cyclus::BidPortfolio<cyclus::Material>::Ptr port,
+      const std::vector<cyclus::Request<cyclus::Material>*>& reqs,
+      const std::deque<cyclus::Material::Ptr>& mats);
+
+  /// Returns the number of assemblies in the spent fuel inventory.
+  int n_spent() { return n_spent_; }
+
+  /// Returns the remaining capacity (kg) of the spent fuel inventory.
+  double spent_space() { return n_assem_spent * assem_size - spent_qty_; }
 
   /////// fuel specifications /////////
   #pragma cyclus var { \
@@ -371,14 +488,136 @@ class Reactor : public cyclus::Facility,
   }
   std::vector<double> pref_change_values;
 
+  /////////// exchange options ///////////
+  #pragma cyclus var { \
+    "default": False, \
+    "uilabel": "Aggregate Fresh Fuel Requests", \
+    "doc": "If true, fresh fuel assemblies are requested in a few " \
+           "multi-assembly chunks (of power-of-two sizes) per fuel type " \
+           "instead of with one request per assembly.  Each chunk is " \
+           "exclusive, so fuel is still only ever received in whole " \
+           "assemblies.  This greatly reduces exchange size for large cores " \
+           "at the cost of coarser partial fills when fuel is scarce.", \
+  }
+  bool aggregate_requests;
+
+  #pragma cyclus var { \
+    "default": [], \
+    "uilabel": "Ignored Reactor Events", \
+    "doc": "Reactor event types that are not recorded to the ReactorEvents " \
+           "table.  Valid types are CYCLE_START, CYCLE_END, LOAD, " \
+           "DISCHARGE, DISCHARGE_FAILED, TRANSMUTE and RETIRED.", \
+  }
+  std::vector<std::string> ignored_events;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "uilabel": "Aggregate Spent Fuel Bids", \
+    "doc": "If true, spent assemblies with identical compositions are " \
+           "offered together as a single multi-assembly bid per request " \
+           "instead of with one bid per assembly.  Spent fuel is still only " \
+           "ever traded in whole assemblies.", \
+  }
+  bool aggregate_bids;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "uilabel": "Power Segments", \
+    "doc": "If true, power is recorded to the ReactorPowerSegments table as " \
+           "one (StartTime, EndTime, Value) row per run of time steps with " \
+           "the same power, written when the power changes, instead of one " \
+           "TimeSeriesPower row per time step.  EndTime is the last time " \
+           "step of the run.  tests/power_segments.py reconstructs the " \
+           "per-time-step series.", \
+  }
+  bool power_segments;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "uilabel": "Record Performance", \
+    "doc": "If true, the wall time spent in each time step and exchange " \
+           "callback is recorded to the ArchetypePerf table every time " \
+           "step, with the number of requests, bids or assemblies handled.", \
+  }
+  bool record_perf;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "userlevel": 10, \
+    "uilabel": "Inventory Footprint Interval", \
+    "doc": "If positive, the number of material objects, total quantity and " \
+           "number of distinct compositions held in the fresh, core and " \
+           "spent inventories are recorded to the InventoryFootprint table " \
+           "every this many time steps.", \
+  }
+  int footprint_interval;
+
+  /// records the inventory footprint if one is due this time step
+  void RecordFootprint_();
+
+  // per-phase timings for the current time step; only used if record_perf
+  ArchetypePerf perf_;
+
   // Resource inventories - these must be defined AFTER/BELOW the member vars
   // referenced (e.g. n_batch_fresh, assem_size, etc.).
   #pragma cyclus var {"capacity": "n_assem_fresh * assem_size"}
   cyclus::toolkit::ResBuf<cyclus::Material> fresh;
   #pragma cyclus var {"capacity": "n_assem_core * assem_size"}
   cyclus::toolkit::ResBuf<cyclus::Material> core;
-  #pragma cyclus var {"capacity": "n_assem_spent * assem_size"}
-  cyclus::toolkit::ResBuf<cyclus::Material> spent;
+
+  // Spent assemblies in discharge order, queued separately for each outcommod
+  // (indexed by outcommod id) so bids and trades only touch the assemblies
+  // involved.  Custom SnapshotInv and InitInv persist these as the "spent"
+  // inventory.  Holds at most n_assem_spent assemblies in total.
+  std::vector<std::deque<cyclus::Material::Ptr> > spent_;
+  // total spent quantity (kg) queued on each outcommod id
+  std::vector<double> spent_qtys_;
+  int n_spent_;
+  double spent_qty_;
+
+  // Fuel slot of each assembly in the fresh and core buffers, in buffer
+  // order.  Rebuilt from res_indexes by InitInv.
+  std::deque<int> fresh_slots_;
+  std::deque<int> core_slots_;
+  // The assemblies in the core buffer, in buffer order, so the front of the
+  // core can be transmuted in place without cycling the buffer.  Rebuilt by
+  // InitInv.
+  std::deque<cyclus::Material::Ptr> core_mats_;
+
+  // Interned fuel commodities, populated lazily by InternFuel and never
+  // persisted.  outcommods_ holds the unique outcommods in sorted order and
+  // slot_outcommods_ maps each fuel slot to its outcommod id (-1 if none).
+  std::vector<std::string> outcommods_;
+  std::map<std::string, int> outcommod_ids_;
+  std::map<std::string, int> incommod_slots_;
+  std::vector<int> slot_outcommods_;
+  bool fuel_interned_;
+
+  // Resolved fuel_inrecipes and fuel_outrecipes, indexed by fuel slot.
+  // Recipe changes are picked up by the handles themselves.
+  RecipeHandles inrecipes_;
+  RecipeHandles outrecipes_;
+
+  // Reactor events buffered during the current time step as (event, number
+  // of assemblies), written out by FlushEvents.
+  std::vector<std::pair<ReactorEvent, int> > events_;
+  // Per-event-type flag for whether the event is recorded, built lazily from
+  // ignored_events.
+  std::vector<bool> event_mask_;
+
+  // Pref and recipe changes sorted by time, compiled lazily from the
+  // pref_change_* and recipe_change_* vars, and the index of the next change
+  // to apply.
+  std::vector<FuelChange> fuel_changes_;
+  bool changes_compiled_;
+  int change_cursor_;
+
+  // Tick and Tock skip straight to burning fuel before this time step.  Set
+  // from NextEventTime at the end of each full Tock and not persisted, so
+  // the first time step after a restart always runs in full.
+  int wake_time_;
 
 
   // should be hidden in ui (internal only). True if fuel has already been
@@ -395,8 +634,18 @@ class Reactor : public cyclus::Facility,
   }
   std::map<int, int> res_indexes;
 
-  // populated lazily and no need to persist.
-  std::set<std::string> uniq_outcommods_;
+  // should be hidden in ui (internal only). Start time and power of the
+  // power segment not yet written, or -1 if there is none.
+  #pragma cyclus var {"default": -1, "doc": "This should NEVER be set manually",\
+                      "internal": True \
+  }
+  int power_seg_start;
+  #pragma cyclus var {"default": 0, "doc": "This should NEVER be set manually",\
+                      "internal": True \
+  }
+  double power_seg_value;
+
+  friend class CallbackBench;
 };
 
 } // namespace cycamore
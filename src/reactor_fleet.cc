@@ -0,0 +1,643 @@
+#include "reactor_fleet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using cyclus::Material;
+using cyclus::Composition;
+using cyclus::KeyError;
+using cyclus::ValueError;
+using cyclus::Request;
+
+namespace cycamore {
+
+ReactorFleet::ReactorFleet(cyclus::Context* ctx)
+    : cyclus::Facility(ctx),
+      n_units(1),
+      assem_size(0),
+      n_assem_batch(0),
+      n_assem_core(0),
+      n_assem_fresh(0),
+      n_assem_spent(0),
+      cycle_time(0),
+      refuel_time(0),
+      power_cap(0),
+      power_name("power"),
+      record_perf(false),
+      units_init_(false),
+      n_spent_(0),
+      spent_qty_(0),
+      fuel_interned_(false) {}
+
+#pragma cyclus def clone cycamore::ReactorFleet
+
+#pragma cyclus def schema cycamore::ReactorFleet
+
+#pragma cyclus def annotations cycamore::ReactorFleet
+
+#pragma cyclus def infiletodb cycamore::ReactorFleet
+
+#pragma cyclus def snapshot cycamore::ReactorFleet
+
+cyclus::Inventories ReactorFleet::SnapshotInv() {
+  InitUnits();
+  cyclus::Inventories invs;
+  std::vector<cyclus::Resource::Ptr>& fresh_inv = invs["fresh"];
+  fresh_inv.insert(fresh_inv.end(), fresh_.begin(), fresh_.end());
+
+  // cores are stored in unit order and split again using core_counts
+  std::vector<cyclus::Resource::Ptr>& core_inv = invs["core"];
+  for (int u = 0; u < n_units; u++) {
+    for (int i = 0; i < core_counts[u]; i++) {
+      core_inv.push_back(core_mats_[core_pos(u, i)]);
+    }
+  }
+
+  std::vector<cyclus::Resource::Ptr>& spent_inv = invs["spent"];
+  for (int i = 0; i < spent_.size(); i++) {
+    SpentQueues::iterator it;
+    for (it = spent_[i].begin(); it != spent_[i].end(); ++it) {
+      spent_inv.insert(spent_inv.end(), it->second.begin(), it->second.end());
+    }
+  }
+  return invs;
+}
+
+void ReactorFleet::InitInv(cyclus::Inventories& inv) {
+  InternFuel();
+  InitUnits();
+
+  std::vector<cyclus::Resource::Ptr>& fresh_inv = inv["fresh"];
+  for (int i = 0; i < fresh_inv.size(); i++) {
+    fresh_.push_back(cyclus::ResCast<Material>(fresh_inv[i]));
+    fresh_slots_.push_back(fuel_slot(fresh_inv[i]));
+  }
+
+  std::vector<cyclus::Resource::Ptr>& core_inv = inv["core"];
+  std::vector<int> counts(core_counts);
+  std::fill(core_counts.begin(), core_counts.end(), 0);
+  int k = 0;
+  for (int u = 0; u < n_units; u++) {
+    for (int i = 0; i < counts[u] && k < core_inv.size(); i++, k++) {
+      PushCore(u, cyclus::ResCast<Material>(core_inv[k]),
+               fuel_slot(core_inv[k]));
+    }
+  }
+
+  std::vector<cyclus::Resource::Ptr>& spent_inv = inv["spent"];
+  for (int i = 0; i < spent_inv.size(); i++) {
+    PushSpent(cyclus::ResCast<Material>(spent_inv[i]), fuel_slot(spent_inv[i]));
+  }
+}
+
+void ReactorFleet::InitFrom(ReactorFleet* m) {
+  #pragma cyclus impl initfromcopy cycamore::ReactorFleet
+  cyclus::toolkit::CommodityProducer::Copy(m);
+}
+
+void ReactorFleet::InitFrom(cyclus::QueryableBackend* b) {
+  #pragma cyclus impl initfromdb cycamore::ReactorFleet
+
+  namespace tk = cyclus::toolkit;
+  double cap = power_cap * n_units;
+  tk::CommodityProducer::Add(tk::Commodity(power_name),
+                             tk::CommodInfo(cap, cap));
+}
+
+void ReactorFleet::EnterNotify() {
+  cyclus::Facility::EnterNotify();
+
+  if (fuel_prefs.size() == 0) {
+    for (int i = 0; i < fuel_incommods.size(); i++) {
+      fuel_prefs.push_back(cyclus::kDefaultPref);
+    }
+  }
+
+  // input consistency checking:
+  std::stringstream ss;
+  if (n_units < 1) {
+    ss << "prototype '" << prototype() << "' has " << n_units
+       << " n_units, expected at least 1\n";
+  }
+  if (cycle_steps.size() != 0 && cycle_steps.size() != n_units) {
+    ss << "prototype '" << prototype() << "' has " << cycle_steps.size()
+       << " cycle_steps vals, expected 0 or " << n_units << "\n";
+  }
+  if (ss.str().size() > 0) {
+    throw cyclus::ValueError(ss.str());
+  }
+
+  InitUnits();
+}
+
+bool ReactorFleet::CheckDecommissionCondition() {
+  InitUnits();
+  for (int u = 0; u < n_units; u++) {
+    if (core_counts[u] > 0) {
+      return false;
+    }
+  }
+  return n_spent_ == 0;
+}
+
+void ReactorFleet::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
+  InitUnits();
+
+  // outrecipes resolved once per time step and shared by every unit
+  std::vector<Composition::Ptr> comps(fuel_outrecipes.size());
+
+  if (retired()) {
+    for (int u = 0; u < n_units; u++) {
+      Record(u, EVENT_RETIRED);
+    }
+
+    // record the last power entries and transmute the units that were
+    // operating at the time of retirement
+    if (exit_time() == context()->time()) {
+      power_.assign(n_units, 0);
+      for (int u = 0; u < n_units; u++) {
+        if (cycle_steps[u] > 0 && cycle_steps[u] <= cycle_time && full(u)) {
+          power_[u] = power_cap;
+        }
+        Transmute(u, ceil(static_cast<double>(n_assem_core) / 2.0), &comps);
+      }
+    }
+
+    for (int u = 0; u < n_units; u++) {
+      while (core_counts[u] > 0) {
+        if (!Discharge(u)) {
+          break;
+        }
+      }
+    }
+    while (!fresh_.empty() && spent_space() >= assem_size) {
+      PushSpent(fresh_.front(), fresh_slots_.front());
+      fresh_.pop_front();
+      fresh_slots_.pop_front();
+    }
+    return;
+  }
+
+  for (int u = 0; u < n_units; u++) {
+    if (cycle_steps[u] == cycle_time) {
+      Transmute(u, n_assem_batch, &comps);
+      Record(u, EVENT_CYCLE_END);
+    }
+    if (cycle_steps[u] >= cycle_time && !discharged[u]) {
+      discharged[u] = Discharge(u);
+    }
+    if (cycle_steps[u] >= cycle_time) {
+      Load(u);
+    }
+  }
+}
+
+void ReactorFleet::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  InitUnits();
+  if (retired()) {
+    Flush();
+    return;
+  }
+
+  power_.assign(n_units, 0);
+  for (int u = 0; u < n_units; u++) {
+    if (cycle_steps[u] >= cycle_time + refuel_time && full(u)) {
+      discharged[u] = 0;
+      cycle_steps[u] = 0;
+    }
+
+    if (cycle_steps[u] == 0 && full(u)) {
+      Record(u, EVENT_CYCLE_START);
+    }
+
+    if (cycle_steps[u] >= 0 && cycle_steps[u] < cycle_time && full(u)) {
+      power_[u] = power_cap;
+    }
+
+    // "if" prevents starting cycle after initial deployment until core is
+    // full even though cycle_step is its initial zero.
+    if (cycle_steps[u] > 0 || full(u)) {
+      cycle_steps[u]++;
+    }
+  }
+
+  Flush();
+}
+
+std::set<cyclus::RequestPortfolio<Material>::Ptr>
+ReactorFleet::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
+  using cyclus::RequestPortfolio;
+  InitUnits();
+
+  std::set<RequestPortfolio<Material>::Ptr> ports;
+  if (retired()) {
+    return ports;
+  }
+
+  int n_assem_order =
+      n_units * n_assem_fresh - static_cast<int>(fresh_.size());
+  for (int u = 0; u < n_units; u++) {
+    n_assem_order += n_assem_core - core_counts[u];
+  }
+
+  if (exit_time() != -1) {
+    // as in Reactor, reduces the order to the amount each unit needs until
+    // retirement; the +1 accounts for the fleet operating during its
+    // exit_time time step.
+    int t_left = exit_time() - context()->time() + 1;
+    int n_need = 0;
+    for (int u = 0; u < n_units; u++) {
+      int t_left_cycle = cycle_time + refuel_time - cycle_steps[u];
+      double n_cycles_left = static_cast<double>(t_left - t_left_cycle) /
+                             static_cast<double>(cycle_time + refuel_time);
+      n_cycles_left = ceil(n_cycles_left);
+      n_need += std::max(0.0, n_cycles_left * n_assem_batch - n_assem_fresh +
+                                  n_assem_core - core_counts[u]);
+    }
+    n_assem_order = std::min(n_assem_order, n_need);
+  }
+
+  if (n_assem_order <= 0) {
+    return ports;
+  }
+
+  // one exclusive request per power-of-two sized chunk of assemblies
+  std::vector<int> sizes;
+  int n_left = n_assem_order;
+  while (n_left > 0) {
+    int n = 1;
+    while (2 * n <= n_left) {
+      n *= 2;
+    }
+    sizes.push_back(n);
+    n_left -= n;
+  }
+
+  std::vector<Composition::Ptr> recipes;
+  for (int j = 0; j < fuel_incommods.size(); j++) {
+    recipes.push_back(inrecipes_.Get(context(), fuel_inrecipes, j));
+  }
+
+  for (int i = 0; i < sizes.size(); i++) {
+    RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
+    std::vector<Request<Material>*> mreqs;
+    for (int j = 0; j < fuel_incommods.size(); j++) {
+      Material::Ptr m =
+          Material::CreateUntracked(sizes[i] * assem_size, recipes[j]);
+      Request<Material>* r =
+          port->AddRequest(m, this, fuel_incommods[j], fuel_prefs[j], true);
+      mreqs.push_back(r);
+    }
+    port->AddMutualReqs(mreqs);
+    ports.insert(port);
+  }
+
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
+  return ports;
+}
+
+void ReactorFleet::AcceptMatlTrades(const std::vector<
+    std::pair<cyclus::Trade<Material>, Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
+  InitUnits();
+  std::vector<std::pair<cyclus::Trade<cyclus::Material>,
+                        cyclus::Material::Ptr> >::const_iterator trade;
+
+  // split multi-assembly trades back into single assemblies
+  std::vector<std::pair<std::string, Material::Ptr> > assems;
+  for (trade = responses.begin(); trade != responses.end(); ++trade) {
+    std::string commod = trade->first.request->commodity();
+    Material::Ptr m = trade->second;
+    int n = static_cast<int>(m->quantity() / assem_size + 0.5);
+    for (int i = 1; i < n; i++) {
+      assems.push_back(std::make_pair(commod, m->ExtractQty(assem_size)));
+    }
+    assems.push_back(std::make_pair(commod, m));
+  }
+
+  // fill the cores of the lowest numbered units first
+  std::vector<int> nload(n_units, 0);
+  int u = 0;
+  for (int i = 0; i < assems.size(); i++) {
+    Material::Ptr m = assems[i].second;
+    int slot = index_res(m, assems[i].first);
+    while (u < n_units && full(u)) {
+      u++;
+    }
+    if (u < n_units) {
+      PushCore(u, m, slot);
+      nload[u]++;
+    } else {
+      fresh_.push_back(m);
+      fresh_slots_.push_back(slot);
+    }
+  }
+
+  for (u = 0; u < n_units; u++) {
+    if (nload[u] > 0) {
+      Record(u, EVENT_LOAD, nload[u]);
+    }
+  }
+}
+
+std::set<cyclus::BidPortfolio<Material>::Ptr> ReactorFleet::GetMatlBids(
+    cyclus::CommodMap<Material>::type& commod_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
+  using cyclus::BidPortfolio;
+
+  std::set<BidPortfolio<Material>::Ptr> ports;
+
+  InternFuel();
+  for (int i = 0; i < outcommods_.size(); i++) {
+    std::vector<Request<Material>*>& reqs = commod_requests[outcommods_[i]];
+    const SpentQueues& queues = spent_[i];
+    if (reqs.size() == 0 || queues.empty()) {
+      continue;
+    }
+
+    // one bid per composition and request
+    BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
+    SpentQueues::const_iterator it;
+    for (int j = 0; j < reqs.size(); j++) {
+      Request<Material>* req = reqs[j];
+      // never offer a partial assembly
+      double want = std::floor(req->target()->quantity() / assem_size +
+                               cyclus::eps_rsrc());
+      want = std::max(want, 1.0);
+      for (it = queues.begin(); it != queues.end(); ++it) {
+        int n = it->second.size();
+        if (want < n) {
+          n = static_cast<int>(want);
+        }
+        Composition::Ptr c = it->second.front()->comp();
+        Material::Ptr offer = Material::CreateUntracked(n * assem_size, c);
+        port->AddBid(req, offer, this, true);
+      }
+    }
+
+    for (it = queues.begin(); it != queues.end(); ++it) {
+      cyclus::Converter<Material>::Ptr conv(new SpentCompConverter(it->first));
+      cyclus::CapacityConstraint<Material> cc(it->second.size() * assem_size,
+                                              conv);
+      port->AddConstraint(cc);
+    }
+    cyclus::CapacityConstraint<Material> cc(spent_qtys_[i]);
+    port->AddConstraint(cc);
+    ports.insert(port);
+  }
+
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
+  return ports;
+}
+
+void ReactorFleet::GetMatlTrades(
+    const std::vector<cyclus::Trade<Material> >& trades,
+    std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
+        responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
+
+  InternFuel();
+  for (int i = 0; i < trades.size(); i++) {
+    std::string commod = trades[i].request->commodity();
+    std::map<std::string, int>::iterator it = outcommod_ids_.find(commod);
+    if (it == outcommod_ids_.end()) {
+      throw ValueError("cycamore::ReactorFleet - no spent fuel offered on " +
+                       commod);
+    }
+
+    // split bids back into the whole assemblies they represent
+    int comp_id = trades[i].bid->offer()->comp()->id();
+    int n = std::max(1, static_cast<int>(
+                            std::floor(trades[i].amt / assem_size + 0.5)));
+    if (n > CountSpent(it->second, comp_id)) {
+      throw ValueError("cycamore::ReactorFleet - too few spent assemblies of the "
+                       "traded composition offered on " + commod);
+    }
+    Material::Ptr m = PopSpent(it->second, comp_id);
+    res_indexes.erase(m->obj_id());
+    for (int j = 1; j < n; j++) {
+      Material::Ptr assem = PopSpent(it->second, comp_id);
+      res_indexes.erase(assem->obj_id());
+      m->Absorb(assem);
+    }
+    responses.push_back(std::make_pair(trades[i], m));
+  }
+}
+
+void ReactorFleet::InitUnits() {
+  if (units_init_) {
+    return;
+  }
+  units_init_ = true;
+
+  cycle_steps.resize(n_units, 0);
+  discharged.resize(n_units, 0);
+  core_counts.resize(n_units, 0);
+  core_heads_.assign(n_units, 0);
+  core_mats_.assign(n_units * n_assem_core, Material::Ptr());
+  core_slots_.assign(n_units * n_assem_core, -1);
+}
+
+void ReactorFleet::InternFuel() {
+  if (fuel_interned_) {
+    return;
+  }
+  fuel_interned_ = true;
+
+  std::set<std::string> uniq(fuel_outcommods.begin(), fuel_outcommods.end());
+  outcommods_.assign(uniq.begin(), uniq.end());
+  for (int i = 0; i < outcommods_.size(); i++) {
+    outcommod_ids_[outcommods_[i]] = i;
+  }
+
+  for (int i = 0; i < fuel_incommods.size(); i++) {
+    // first match wins, same as a linear scan of fuel_incommods
+    incommod_slots_.insert(std::make_pair(fuel_incommods[i], i));
+    if (i < fuel_outcommods.size()) {
+      slot_outcommods_.push_back(outcommod_ids_[fuel_outcommods[i]]);
+    } else {
+      slot_outcommods_.push_back(-1);
+    }
+  }
+
+  spent_.resize(outcommods_.size());
+  spent_qtys_.resize(outcommods_.size(), 0);
+}
+
+int ReactorFleet::fuel_slot(cyclus::Resource::Ptr m) {
+  std::map<int, int>::iterator it = res_indexes.find(m->obj_id());
+  if (it == res_indexes.end() || it->second >= fuel_incommods.size()) {
+    throw KeyError("cycamore::ReactorFleet - no fuel index for material object");
+  }
+  return it->second;
+}
+
+int ReactorFleet::index_res(cyclus::Resource::Ptr m,
+                            const std::string& incommod) {
+  InternFuel();
+  std::map<std::string, int>::iterator it = incommod_slots_.find(incommod);
+  if (it == incommod_slots_.end()) {
+    throw ValueError(
+        "cycamore::ReactorFleet - received unsupported incommod material");
+  }
+  res_indexes[m->obj_id()] = it->second;
+  return it->second;
+}
+
+void ReactorFleet::PushCore(int u, Material::Ptr m, int slot) {
+  int pos = core_pos(u, core_counts[u]);
+  core_mats_[pos] = m;
+  core_slots_[pos] = slot;
+  core_counts[u]++;
+}
+
+bool ReactorFleet::Discharge(int u) {
+  int npop = std::min(n_assem_batch, core_counts[u]);
+  if (static_cast<double>(n_units) * n_assem_spent - n_spent_ < npop) {
+    Record(u, EVENT_DISCHARGE_FAILED, npop);
+    return false;  // not enough room in spent buffer
+  }
+
+  Record(u, EVENT_DISCHARGE, npop);
+  for (int i = 0; i < npop; i++) {
+    int pos = core_pos(u, 0);
+    PushSpent(core_mats_[pos], core_slots_[pos]);
+    core_mats_[pos].reset();
+    core_heads_[u] = (core_heads_[u] + 1) % n_assem_core;
+    core_counts[u]--;
+  }
+  return true;
+}
+
+void ReactorFleet::Load(int u) {
+  int n = std::min(n_assem_core - core_counts[u],
+                   static_cast<int>(fresh_.size()));
+  if (n == 0) {
+    return;
+  }
+
+  Record(u, EVENT_LOAD, n);
+  for (int i = 0; i < n; i++) {
+    PushCore(u, fresh_.front(), fresh_slots_.front());
+    fresh_.pop_front();
+    fresh_slots_.pop_front();
+  }
+}
+
+void ReactorFleet::Transmute(int u, int n,
+                             std::vector<Composition::Ptr>* comps) {
+  n = std::min(n, core_counts[u]);
+  Record(u, EVENT_TRANSMUTE, n);
+
+  for (int i = 0; i < n; i++) {
+    int pos = core_pos(u, i);
+    int slot = core_slots_[pos];
+    Composition::Ptr& c = (*comps)[slot];
+    if (c.get() == NULL) {
+      c = outrecipes_.Get(context(), fuel_outrecipes, slot);
+    }
+    core_mats_[pos]->Transmute(c);
+  }
+}
+
+void ReactorFleet::PushSpent(Material::Ptr m, int slot) {
+  InternFuel();
+  int commod = slot_outcommods_[slot];
+  if (commod < 0) {
+    throw KeyError("cycamore::ReactorFleet - no outcommod for material object");
+  }
+  spent_[commod][m->comp()->id()].push_back(m);
+  spent_qtys_[commod] += m->quantity();
+  spent_qty_ += m->quantity();
+  n_spent_++;
+}
+
+int ReactorFleet::CountSpent(int outcommod, int comp_id) {
+  const SpentQueues& queues = spent_[outcommod];
+  SpentQueues::const_iterator it = queues.find(comp_id);
+  return it == queues.end() ? 0 : static_cast<int>(it->second.size());
+}
+
+Material::Ptr ReactorFleet::PopSpent(int outcommod, int comp_id) {
+  SpentQueues& queues = spent_[outcommod];
+  SpentQueues::iterator it = queues.find(comp_id);
+  if (it == queues.end()) {
+    throw ValueError("cycamore::ReactorFleet - no spent fuel of the traded "
+                     "composition offered on " + outcommods_[outcommod]);
+  }
+
+  // oldest assemblies of the composition are traded away first
+  Material::Ptr m = it->second.front();
+  it->second.pop_front();
+  if (it->second.empty()) {
+    queues.erase(it);
+  }
+  spent_qtys_[outcommod] -= m->quantity();
+  spent_qty_ -= m->quantity();
+  n_spent_--;
+
+  // avoid drift from accumulated floating point error
+  if (queues.empty()) {
+    spent_qtys_[outcommod] = 0;
+  }
+  if (n_spent_ == 0) {
+    spent_qty_ = 0;
+  }
+  return m;
+}
+
+void ReactorFleet::Record(int u, ReactorEvent ev, int n) {
+  FleetEvent e = {u, ev, n};
+  events_.push_back(e);
+}
+
+void ReactorFleet::Flush() {
+  std::vector<FleetEvent> events;
+  events.swap(events_);
+  std::vector<double> power;
+  power.swap(power_);
+  if (events.empty() && power.empty()) {
+    return;
+  }
+
+  datum_stage_.Write([this, events, power]() {
+    for (int i = 0; i < events.size(); i++) {
+      context()
+          ->NewDatum("ReactorFleetEvents")
+          ->AddVal("AgentId", id())
+          ->AddVal("Time", context()->time())
+          ->AddVal("Unit", events[i].unit)
+          ->AddVal("Event", std::string(ReactorEventName(events[i].ev)))
+          ->AddVal("Value", events[i].n)
+          ->Record();
+    }
+
+    if (power.empty()) {
+      return;
+    }
+    double total = 0;
+    for (int u = 0; u < power.size(); u++) {
+      total += power[u];
+      context()
+          ->NewDatum("ReactorFleetPower")
+          ->AddVal("AgentId", id())
+          ->AddVal("Time", context()->time())
+          ->AddVal("Unit", u)
+          ->AddVal("Value", power[u])
+          ->Record();
+    }
+    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, total);
+  });
+}
+
+extern "C" cyclus::Agent* ConstructReactorFleet(cyclus::Context* ctx) {
+  return new ReactorFleet(ctx);
+}
+
+}  // namespace cycamore
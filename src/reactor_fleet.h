@@ -0,0 +1,390 @@
+#ifndef CYCAMORE_SRC_REACTOR_FLEET_H_
+#define CYCAMORE_SRC_REACTOR_FLEET_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+#include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "recipe_cache.h"
+#include "reactor.h"
+
+namespace cycamore {
+
+/// A reactor event of one unit of a ReactorFleet involving n assemblies.
+struct FleetEvent {
+  int unit;
+  ReactorEvent ev;
+  int n;
+};
+
+/// ReactorFleet models n_units identical reactors as a single agent.  Each
+/// unit follows the same cycle as a Reactor - at the end of every cycle a
+/// batch of n_assem_batch assemblies is transmuted to its spent fuel recipe
+/// and discharged, the core is topped up from fresh fuel, and the next cycle
+/// starts after refuel_time once the unit's core is full.
+///
+/// Per-unit state (cycle step, discharge flag and core contents) is held in
+/// contiguous arrays, and the units share one configuration, one fresh fuel
+/// pool of n_units * n_assem_fresh assemblies and one spent fuel pool of
+/// n_units * n_assem_spent assemblies.  Fresh fuel is requested for the whole
+/// fleet in a few exclusive, power-of-two sized multi-assembly requests per
+/// fuel type, and spent fuel is offered with one bid per composition, so the
+/// exchange grows with the number of fuel types and compositions rather than
+/// with the number of units.  Received fuel goes to the cores of the lowest
+/// numbered units with room first and then to the fresh fuel pool.
+///
+/// Each unit's power is recorded to the ReactorFleetPower table and its
+/// events to the ReactorFleetEvents table, and the fleet total is recorded as
+/// the agent's power time series.  Preference and recipe changes are not
+/// supported.
+///
+/// All units share the agent's lifetime.  When it ends, every unit
+/// discharges its core (transmuting half of it if it was mid-cycle) and the
+/// fleet trades away its spent fuel before decommissioning.
+class ReactorFleet : public cyclus::Facility,
+  public cyclus::toolkit::CommodityProducer,
+  public ConcurrentTimeListener {
+#pragma cyclus note { \
+"niche": "reactor", \
+"doc": \
+  "ReactorFleet models a number of identical reactors as a single agent." \
+  " Each unit follows the same cycle as a Reactor: at the end of every cycle" \
+  " a batch of assemblies is transmuted to its spent fuel recipe and" \
+  " discharged, the core is topped up from fresh fuel, and the next cycle" \
+  " starts after the refueling time once the unit's core is full." \
+  "\n\n" \
+  "The units share one configuration, one fresh fuel inventory and one" \
+  " spent fuel inventory.  Fresh fuel is requested for the whole fleet in a" \
+  " few multi-assembly requests per fuel type and spent fuel is offered" \
+  " with one bid per composition, so large fleets do not grow the resource" \
+  " exchange.  Per-unit power and reactor events are recorded to the" \
+  " ReactorFleetPower and ReactorFleetEvents tables.  Preference and recipe" \
+  " changes are not supported." \
+  "", \
+}
+
+  friend class ReactorFleetTest;
+
+ public:
+  ReactorFleet(cyclus::Context* ctx);
+  virtual ~ReactorFleet() {}
+
+  virtual std::string version() { return CYCAMORE_VERSION; }
+
+  virtual void Tick();
+  virtual void Tock();
+  virtual void EnterNotify();
+  virtual bool CheckDecommissionCondition();
+
+  virtual void AcceptMatlTrades(const std::vector<std::pair<
+      cyclus::Trade<cyclus::Material>, cyclus::Material::Ptr> >& responses);
+
+  virtual std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
+  GetMatlRequests();
+
+  virtual std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> GetMatlBids(
+      cyclus::CommodMap<cyclus::Material>::type& commod_requests);
+
+  virtual void GetMatlTrades(
+      const std::vector<cyclus::Trade<cyclus::Material> >& trades,
+      std::vector<std::pair<cyclus::Trade<cyclus::Material>,
+                            cyclus::Material::Ptr> >& responses);
+
+  #pragma cyclus decl clone
+  #pragma cyclus decl initfromcopy
+  #pragma cyclus decl initfromdb
+  #pragma cyclus decl infiletodb
+  #pragma cyclus decl schema
+  #pragma cyclus decl annotations
+  #pragma cyclus decl snapshot
+  // the following pragmas are ommitted and the functions are written
+  // manually in order to handle the per-unit cores and the pooled fresh and
+  // spent fuel:
+  //
+  //     #pragma cyclus decl snapshotinv
+  //     #pragma cyclus decl initinv
+
+  virtual cyclus::Inventories SnapshotInv();
+  virtual void InitInv(cyclus::Inventories& inv);
+
+ private:
+  bool retired() {
+    return exit_time() != -1 && context()->time() >= exit_time();
+  }
+
+  /// Sizes the per-unit arrays for n_units, keeping any per-unit state that
+  /// was configured or restored.  Does nothing after the first call.
+  void InitUnits();
+
+  /// Interns the fuel commodities as in Reactor::InternFuel.  Does nothing
+  /// after the first call.
+  void InternFuel();
+
+  /// Returns the fuel slot (index into the fuel_* vectors) for the incommod
+  /// through which the given material was received.
+  int fuel_slot(cyclus::Resource::Ptr m);
+
+  /// Stores the fuel slot for a resource received on incommod and returns it.
+  int index_res(cyclus::Resource::Ptr m, const std::string& incommod);
+
+  /// Returns true if unit u has a full core.
+  bool full(int u) { return core_counts[u] == n_assem_core; }
+
+  /// Index into the core arrays of the i-th oldest assembly in unit u's core.
+  int core_pos(int u, int i) {
+    return u * n_assem_core + (core_heads_[u] + i) % n_assem_core;
+  }
+
+  /// Adds an assembly received through the given fuel slot to the back of
+  /// unit u's core.
+  void PushCore(int u, cyclus::Material::Ptr m, int slot);
+
+  /// Discharges a batch from unit u's core if there is room in the spent
+  /// fuel inventory.  Returns true if a batch was discharged.
+  bool Discharge(int u);
+
+  /// Tops up unit u's core from the fresh fuel inventory as much as possible.
+  void Load(int u);
+
+  /// Transmutes the n oldest assemblies in unit u's core to their outrecipes.
+  /// Recipes are resolved into comps, indexed by fuel slot, on first use so
+  /// that every unit transmuted in a time step shares them.
+  void Transmute(int u, int n, std::vector<cyclus::Composition::Ptr>* comps);
+
+  /// Adds an assembly received through the given fuel slot to the back of
+  /// the spent fuel queue for its outcommod and composition.
+  void PushSpent(cyclus::Material::Ptr m, int slot);
+
+  /// Returns the number of spent assemblies with composition comp_id offered
+  /// on the outcommod with the given interned id.
+  int CountSpent(int outcommod, int comp_id);
+
+  /// Removes and returns the oldest spent assembly with composition comp_id
+  /// offered on the outcommod with the given interned id.  It is an error if
+  /// there is none.
+  cyclus::Material::Ptr PopSpent(int outcommod, int comp_id);
+
+  /// Returns the remaining capacity (kg) of the spent fuel inventory.
+  double spent_space() {
+    return static_cast<double>(n_units) * n_assem_spent * assem_size -
+           spent_qty_;
+  }
+
+  /// Buffers an event of unit u involving n assemblies.
+  void Record(int u, ReactorEvent ev, int n = 0);
+
+  /// Records the buffered events and unit powers for this time step through
+  /// the datum stage.
+  void Flush();
+
+  /////// fuel specifications /////////
+  #pragma cyclus var { \
+    "uitype": ["oneormore", "incommodity"], \
+    "uilabel": "Fresh Fuel Commodity List", \
+    "doc": "Ordered list of input commodities on which to requesting fuel.", \
+  }
+  std::vector<std::string> fuel_incommods;
+  #pragma cyclus var { \
+    "uitype": ["oneormore", "inrecipe"], \
+    "uilabel": "Fresh Fuel Recipe List", \
+    "doc": "Fresh fuel recipes to request for each of the given fuel input " \
+           "commodities (same order).", \
+  }
+  std::vector<std::string> fuel_inrecipes;
+  #pragma cyclus var { \
+    "default": [], \
+    "uilabel": "Fresh Fuel Preference List", \
+    "doc": "The preference for each type of fresh fuel requested corresponding"\
+           " to each input commodity (same order).  If no preferences are " \
+           "specified, 1.0 is used for all fuel requests (default).", \
+  }
+  std::vector<double> fuel_prefs;
+  #pragma cyclus var { \
+    "uitype": ["oneormore", "outcommodity"], \
+    "uilabel": "Spent Fuel Commodity List", \
+    "doc": "Output commodities on which to offer spent fuel originally " \
+           "received as each particular input commodity (same order)." \
+  }
+  std::vector<std::string> fuel_outcommods;
+  #pragma cyclus var { \
+    "uitype": ["oneormore", "outrecipe"], \
+    "uilabel": "Spent Fuel Recipe List", \
+    "doc": "Spent fuel recipes corresponding to the given fuel input " \
+           "commodities (same order).  Fuel received via a particular input " \
+           "commodity is transmuted to the recipe specified here after being " \
+           "burned during a cycle.", \
+  }
+  std::vector<std::string> fuel_outrecipes;
+
+  //////////// fleet params ////////////
+  #pragma cyclus var { \
+    "default": 1, \
+    "uilabel": "Number of Units", \
+    "doc": "Number of identical reactor units in the fleet.", \
+  }
+  int n_units;
+
+  //////////// inventory and core params ////////////
+  #pragma cyclus var { \
+    "doc": "Mass (kg) of a single assembly.", \
+    "uilabel": "Assembly Mass", \
+    "uitype": "range", \
+    "range": [1.0, 1e5], \
+    "units": "kg", \
+  }
+  double assem_size;
+  #pragma cyclus var { \
+    "uilabel": "Number of Assemblies per Batch", \
+    "doc": "Number of assemblies discharged from each unit's core fully " \
+           "burned each cycle.", \
+  }
+  int n_assem_batch;
+  #pragma cyclus var { \
+    "default": 3, \
+    "uilabel": "Number of Assemblies in Core", \
+    "doc": "Number of assemblies that constitute a full core of one unit.", \
+  }
+  int n_assem_core;
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Minimum Fresh Fuel Inventory per Unit", \
+    "units": "assemblies", \
+    "doc": "Number of fresh fuel assemblies to keep on-hand for each unit " \
+           "if possible.  Fresh fuel is pooled across the fleet.", \
+  }
+  int n_assem_fresh;
+  #pragma cyclus var { \
+    "default": 1000000000, \
+    "uilabel": "Maximum Spent Fuel Inventory per Unit", \
+    "units": "assemblies", \
+    "doc": "Number of spent fuel assemblies per unit that can be stored " \
+           "on-site before unit operation stalls.  Spent fuel is pooled " \
+           "across the fleet.", \
+  }
+  int n_assem_spent;
+
+  ///////// cycle params ///////////
+  #pragma cyclus var { \
+    "default": 18, \
+    "doc": "The duration of a full operational cycle (excluding refueling " \
+           "time) in time steps.", \
+    "uilabel": "Cycle Length", \
+    "units": "time steps", \
+  }
+  int cycle_time;
+  #pragma cyclus var { \
+    "default": 1, \
+    "doc": "The duration of a full refueling period - the minimum time between"\
+           " the end of a cycle and the start of the next cycle.", \
+    "uilabel": "Refueling Outage Duration", \
+    "units": "time steps", \
+  }
+  int refuel_time;
+  #pragma cyclus var { \
+    "default": [], \
+    "doc": "Number of time steps since the start of the last cycle of each " \
+           "unit.  If empty (the default) every unit starts at zero; set " \
+           "one value per unit to stagger the units' outages.", \
+    "uilabel": "Time Since Start of Last Cycle per Unit", \
+    "units": "time steps", \
+  }
+  std::vector<int> cycle_steps;
+
+  //////////// power params ////////////
+  #pragma cyclus var { \
+    "default": 0, \
+    "doc": "Amount of electrical power each unit produces when operating " \
+           "normally.", \
+    "uilabel": "Nominal Unit Power", \
+    "uitype": "range", \
+    "range": [0.0, 2000.00], \
+    "units": "MWe", \
+  }
+  double power_cap;
+  #pragma cyclus var { \
+    "default": "power", \
+    "uilabel": "Power Commodity Name", \
+    "doc": "The name of the 'power' commodity used in conjunction with a " \
+           "deployment curve.", \
+  }
+  std::string power_name;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "uilabel": "Record Performance", \
+    "doc": "If true, the wall time spent in each time step and exchange " \
+           "callback of the whole fleet is recorded to the ArchetypePerf " \
+           "table every time step.", \
+  }
+  bool record_perf;
+
+  // per-phase timings for the current time step; only used if record_perf
+  ArchetypePerf perf_;
+
+  // should be hidden in ui (internal only). Nonzero for each unit that has
+  // already discharged this cycle.
+  #pragma cyclus var {"default": [], "doc": "This should NEVER be set manually", \
+                      "internal": True \
+  }
+  std::vector<int> discharged;
+
+  // should be hidden in ui (internal only). Number of assemblies in each
+  // unit's core; the "core" inventory holds the cores in unit order.
+  #pragma cyclus var {"default": [], "doc": "This should NEVER be set manually", \
+                      "internal": True \
+  }
+  std::vector<int> core_counts;
+
+  // This variable should be hidden/unavailable in ui.  Maps resource object
+  // id's to the index for the incommod through which they were received.
+  #pragma cyclus var {"default": {}, "doc": "This should NEVER be set manually", \
+                      "internal": True \
+  }
+  std::map<int, int> res_indexes;
+
+  // Unit cores, n_assem_core slots per unit, each used as a ring starting at
+  // the unit's head.  core_slots_ holds the fuel slot of each assembly.
+  std::vector<cyclus::Material::Ptr> core_mats_;
+  std::vector<int> core_slots_;
+  std::vector<int> core_heads_;
+  bool units_init_;
+
+  // Pooled fresh fuel in arrival order with the fuel slot of each assembly.
+  std::deque<cyclus::Material::Ptr> fresh_;
+  std::deque<int> fresh_slots_;
+
+  // Pooled spent fuel per outcommod id, queued in arrival order per
+  // composition id so that trades take the oldest assemblies of the traded
+  // composition without scanning the others.
+  typedef std::map<int, std::deque<cyclus::Material::Ptr> > SpentQueues;
+  std::vector<SpentQueues> spent_;
+  std::vector<double> spent_qtys_;
+  int n_spent_;
+  double spent_qty_;
+
+  // Interned fuel commodities, as in Reactor.
+  std::vector<std::string> outcommods_;
+  std::map<std::string, int> outcommod_ids_;
+  std::map<std::string, int> incommod_slots_;
+  std::vector<int> slot_outcommods_;
+  bool fuel_interned_;
+
+  // Resolved fuel_inrecipes and fuel_outrecipes, as in Reactor.
+  RecipeHandles inrecipes_;
+  RecipeHandles outrecipes_;
+
+  // Events buffered during the current time step, and each unit's power for
+  // it (empty if no power is recorded this time step).
+  std::vector<FleetEvent> events_;
+  std::vector<double> power_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_REACTOR_FLEET_H_
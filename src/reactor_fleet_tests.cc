@@ -0,0 +1,422 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "context.h"
+#include "cyclus.h"
+#include "reactor_fleet.h"
+
+using pyne::nucname::id;
+using cyclus::Composition;
+using cyclus::Material;
+using cyclus::QueryResult;
+using cyclus::Cond;
+
+namespace cycamore {
+namespace reactorfleettests {
+
+Composition::Ptr c_uox() {
+  cyclus::CompMap m;
+  m[id("u235")] = 0.04;
+  m[id("u238")] = 0.96;
+  return Composition::CreateFromMass(m);
+};
+
+Composition::Ptr c_spentuox() {
+  cyclus::CompMap m;
+  m[id("u235")] =  .8;
+  m[id("u238")] =  100;
+  m[id("pu239")] = 1;
+  return Composition::CreateFromMass(m);
+};
+
+Composition::Ptr c_mox() {
+  cyclus::CompMap m;
+  m[id("u238")] = 0.9;
+  m[id("pu239")] = 0.1;
+  return Composition::CreateFromMass(m);
+};
+
+Composition::Ptr c_spentmox() {
+  cyclus::CompMap m;
+  m[id("u238")] = 90;
+  m[id("pu239")] = 8;
+  m[id("pu240")] = 2;
+  return Composition::CreateFromMass(m);
+};
+
+// returns the total quantity of material received by an agent
+double Received(cyclus::MockSim& sim, int id) {
+  std::stringstream ss;
+  ss << "SELECT SUM(r.Quantity) FROM Transactions AS t"
+     << " INNER JOIN Resources AS r ON r.ResourceId = t.ResourceId"
+     << " WHERE t.ReceiverId = " << id << ";";
+  cyclus::SqlStatement::Ptr stmt = sim.db().db().Prepare(ss.str());
+  stmt->Step();
+  return stmt->GetDouble(0);
+}
+
+// tests that each unit of a fleet orders and burns fuel like a single
+// reactor: with the same settings as ReactorTests.BatchSizes, each unit needs
+// 7 assemblies for its initial core and 3 per time step for each new batch.
+TEST(ReactorFleetTests, BatchSizes) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <n_units>3</n_units>  "
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  ";
+
+  int simdur = 50;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:ReactorFleet"), config,
+                      simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  EXPECT_DOUBLE_EQ(3 * (7 + 3 * (simdur - 1)), Received(sim, id));
+}
+
+// tests that every unit's power is recorded and that the fleet's power time
+// series is the sum over its units.
+TEST(ReactorFleetTests, Power) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <n_units>3</n_units>  "
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  "
+     "  <power_cap>2</power_cap>  ";
+
+  int simdur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:ReactorFleet"), config,
+                      simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Value", "==", 2.0));
+  QueryResult qr = sim.db().Query("ReactorFleetPower", &conds);
+  EXPECT_EQ(3 * simdur, qr.rows.size());
+
+  conds.clear();
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Value", "==", 6.0));
+  qr = sim.db().Query("TimeSeriesPower", &conds);
+  EXPECT_EQ(simdur, qr.rows.size());
+}
+
+// tests that units given different initial cycle steps end their cycles on
+// different time steps.
+TEST(ReactorFleetTests, StaggeredCycles) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <n_units>2</n_units>  "
+     "  <cycle_steps> <val>0</val> <val>1</val> </cycle_steps>  "
+     "  <cycle_time>3</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>1</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  ";
+
+  int simdur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:ReactorFleet"), config,
+                      simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Event", "==", std::string("CYCLE_END")));
+  conds.push_back(Cond("Unit", "==", 0));
+  QueryResult qr = sim.db().Query("ReactorFleetEvents", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(3, qr.GetVal<int>("Time", 0));
+
+  conds.back() = Cond("Unit", "==", 1);
+  qr = sim.db().Query("ReactorFleetEvents", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 0));
+}
+
+}  // namespace reactorfleettests
+
+// Drives a two unit fleet burning uox and mox, both discharged as waste,
+// directly through its callbacks.
+class ReactorFleetTest : public ::testing::Test {
+ public:
+  cyclus::TestContext tc_;
+  ReactorFleet* fleet_;
+  Composition::Ptr uox_;
+  Composition::Ptr mox_;
+  Composition::Ptr spentuox_;
+  Composition::Ptr spentmox_;
+
+  virtual void SetUp() {
+    uox_ = reactorfleettests::c_uox();
+    mox_ = reactorfleettests::c_mox();
+    spentuox_ = reactorfleettests::c_spentuox();
+    spentmox_ = reactorfleettests::c_spentmox();
+    tc_.get()->AddRecipe("uox", uox_);
+    tc_.get()->AddRecipe("mox", mox_);
+    tc_.get()->AddRecipe("spentuox", spentuox_);
+    tc_.get()->AddRecipe("spentmox", spentmox_);
+    fleet_ = NewFleet();
+  }
+
+  virtual void TearDown() { delete fleet_; }
+
+  ReactorFleet* NewFleet() {
+    ReactorFleet* f = new ReactorFleet(tc_.get());
+    f->fuel_incommods.push_back("uox");
+    f->fuel_incommods.push_back("mox");
+    f->fuel_inrecipes.push_back("uox");
+    f->fuel_inrecipes.push_back("mox");
+    f->fuel_outcommods.push_back("waste");
+    f->fuel_outcommods.push_back("waste");
+    f->fuel_outrecipes.push_back("spentuox");
+    f->fuel_outrecipes.push_back("spentmox");
+    f->n_units = 2;
+    f->assem_size = 1;
+    f->n_assem_core = 3;
+    f->n_assem_batch = 1;
+    f->n_assem_spent = 100;
+    f->cycle_time = 10;
+    return f;
+  }
+
+  Material::Ptr Assem(Composition::Ptr c) {
+    return Material::CreateUntracked(1, c);
+  }
+
+  void Core(ReactorFleet* f, int u, Material::Ptr m,
+            const std::string& incommod) {
+    f->InitUnits();
+    f->PushCore(u, m, f->index_res(m, incommod));
+  }
+
+  void Fresh(ReactorFleet* f, Material::Ptr m, const std::string& incommod) {
+    f->fresh_.push_back(m);
+    f->fresh_slots_.push_back(f->index_res(m, incommod));
+  }
+
+  void Spent(ReactorFleet* f, Material::Ptr m, const std::string& incommod) {
+    f->PushSpent(m, f->index_res(m, incommod));
+  }
+
+  int CountSpent(ReactorFleet* f, Composition::Ptr c) {
+    f->InternFuel();
+    return f->CountSpent(f->outcommod_ids_["waste"], c->id());
+  }
+
+  bool Discharge(ReactorFleet* f, int u) { return f->Discharge(u); }
+
+  int ncore(ReactorFleet* f, int u) {
+    f->InitUnits();
+    return f->core_counts[u];
+  }
+
+  Material::Ptr core(ReactorFleet* f, int u, int i) {
+    return f->core_mats_[f->core_pos(u, i)];
+  }
+
+  int core_head(ReactorFleet* f, int u) { return f->core_heads_[u]; }
+
+  int nfresh(ReactorFleet* f) { return f->fresh_.size(); }
+
+  // copies the state variables that a restart restores before InitInv
+  void CopyState(ReactorFleet* src, ReactorFleet* dst) {
+    dst->core_counts = src->core_counts;
+    dst->res_indexes = src->res_indexes;
+  }
+};
+
+// spent fuel of different compositions on one outcommod is offered with one
+// exclusive bid per composition, limited by a constraint per composition,
+// and a trade takes the oldest assemblies of the traded composition only.
+TEST_F(ReactorFleetTest, MixedSpentTrades) {
+  using cyclus::Bid;
+  using cyclus::BidPortfolio;
+  using cyclus::CapacityConstraint;
+  using cyclus::Request;
+  using cyclus::Trade;
+
+  std::vector<Material::Ptr> mox;
+  for (int i = 0; i < 3; i++) {
+    Spent(fleet_, Assem(spentuox_), "uox");
+    mox.push_back(Assem(spentmox_));
+    Spent(fleet_, mox.back(), "mox");
+  }
+  Spent(fleet_, Assem(spentuox_), "uox");
+  EXPECT_EQ(4, CountSpent(fleet_, spentuox_));
+  EXPECT_EQ(3, CountSpent(fleet_, spentmox_));
+
+  cyclus::CommodMap<Material>::type reqs;
+  Request<Material>* req = Request<Material>::Create(
+      Material::CreateUntracked(10, spentuox_), tc_.trader(), "waste");
+  reqs["waste"].push_back(req);
+  std::set<BidPortfolio<Material>::Ptr> ports = fleet_->GetMatlBids(reqs);
+  ASSERT_EQ(1, ports.size());
+  BidPortfolio<Material>::Ptr port = *ports.begin();
+
+  const std::set<Bid<Material>*>& bids = port->bids();
+  ASSERT_EQ(2, bids.size());
+  Bid<Material>* moxbid = NULL;
+  std::set<Bid<Material>*>::const_iterator it;
+  for (it = bids.begin(); it != bids.end(); ++it) {
+    EXPECT_TRUE((*it)->exclusive());
+    int comp_id = (*it)->offer()->comp()->id();
+    if (comp_id == spentmox_->id()) {
+      moxbid = *it;
+      EXPECT_DOUBLE_EQ(3, (*it)->offer()->quantity());
+    } else {
+      EXPECT_EQ(spentuox_->id(), comp_id);
+      EXPECT_DOUBLE_EQ(4, (*it)->offer()->quantity());
+    }
+  }
+  ASSERT_TRUE(moxbid != NULL);
+
+  // one constraint per composition and one on the total
+  Material::Ptr uox1 = Assem(spentuox_);
+  Material::Ptr mox1 = Assem(spentmox_);
+  const std::set<CapacityConstraint<Material> >& ccs = port->constraints();
+  EXPECT_EQ(3, ccs.size());
+  std::set<CapacityConstraint<Material> >::const_iterator cc;
+  for (cc = ccs.begin(); cc != ccs.end(); ++cc) {
+    double u = cc->convert(uox1);
+    double m = cc->convert(mox1);
+    if (u > 0 && m > 0) {
+      EXPECT_DOUBLE_EQ(7, cc->capacity());
+    } else if (m > 0) {
+      EXPECT_DOUBLE_EQ(3, cc->capacity());
+    } else {
+      EXPECT_DOUBLE_EQ(1, u);
+      EXPECT_DOUBLE_EQ(4, cc->capacity());
+    }
+  }
+
+  std::vector<Trade<Material> > trades;
+  trades.push_back(Trade<Material>(req, moxbid, 2));
+  std::vector<std::pair<Trade<Material>, Material::Ptr> > responses;
+  fleet_->GetMatlTrades(trades, responses);
+  ASSERT_EQ(1, responses.size());
+  Material::Ptr m = responses[0].second;
+  EXPECT_DOUBLE_EQ(2, m->quantity());
+  EXPECT_EQ(spentmox_->id(), m->comp()->id());
+  EXPECT_EQ(mox[0]->obj_id(), m->obj_id());
+  EXPECT_EQ(4, CountSpent(fleet_, spentuox_));
+  EXPECT_EQ(1, CountSpent(fleet_, spentmox_));
+
+  // only one mox assembly is left
+  responses.clear();
+  EXPECT_THROW(fleet_->GetMatlTrades(trades, responses), cyclus::ValueError);
+}
+
+// on retirement each unit's core is half transmuted and discharged, and the
+// fresh fuel is moved to the spent fuel pool so that all of it can be traded
+// away before the fleet decommissions.
+TEST_F(ReactorFleetTest, Retire) {
+  fleet_->lifetime(1);
+  fleet_->Build(NULL);
+  for (int u = 0; u < 2; u++) {
+    for (int i = 0; i < 3; i++) {
+      Core(fleet_, u, Assem(uox_), "uox");
+    }
+  }
+  Fresh(fleet_, Assem(mox_), "mox");
+  EXPECT_FALSE(fleet_->CheckDecommissionCondition());
+
+  fleet_->Tick();
+  EXPECT_EQ(0, ncore(fleet_, 0));
+  EXPECT_EQ(0, ncore(fleet_, 1));
+  EXPECT_EQ(0, nfresh(fleet_));
+  // ceil(3 / 2) of each core is transmuted
+  EXPECT_EQ(4, CountSpent(fleet_, spentuox_));
+  EXPECT_EQ(2, CountSpent(fleet_, uox_));
+  EXPECT_EQ(1, CountSpent(fleet_, mox_));
+  EXPECT_FALSE(fleet_->CheckDecommissionCondition());
+
+  using cyclus::Bid;
+  using cyclus::Request;
+  using cyclus::Trade;
+  Request<Material>* req = Request<Material>::Create(
+      Material::CreateUntracked(10, spentuox_), tc_.trader(), "waste");
+  Composition::Ptr comps[] = {spentuox_, uox_, mox_};
+  double qtys[] = {4, 2, 1};
+  std::vector<Trade<Material> > trades;
+  for (int i = 0; i < 3; i++) {
+    Bid<Material>* bid = Bid<Material>::Create(
+        req, Material::CreateUntracked(qtys[i], comps[i]), fleet_);
+    trades.push_back(Trade<Material>(req, bid, qtys[i]));
+  }
+  std::vector<std::pair<Trade<Material>, Material::Ptr> > responses;
+  fleet_->GetMatlTrades(trades, responses);
+  EXPECT_EQ(3, responses.size());
+  EXPECT_TRUE(fleet_->CheckDecommissionCondition());
+}
+
+// the cores are snapshotted oldest assembly first and restored in the same
+// order even though the ring buffer heads are not state variables.
+TEST_F(ReactorFleetTest, SnapshotInvRoundTrip) {
+  std::vector<Material::Ptr> u0;
+  for (int i = 0; i < 4; i++) {
+    u0.push_back(Assem(uox_));
+  }
+  for (int i = 0; i < 3; i++) {
+    Core(fleet_, 0, u0[i], "uox");
+  }
+  ASSERT_TRUE(Discharge(fleet_, 0));
+  Core(fleet_, 0, u0[3], "uox");
+  ASSERT_EQ(1, core_head(fleet_, 0));
+
+  Material::Ptr u1 = Assem(mox_);
+  Core(fleet_, 1, u1, "mox");
+  Material::Ptr fresh = Assem(mox_);
+  Fresh(fleet_, fresh, "mox");
+  Spent(fleet_, Assem(spentmox_), "mox");
+
+  cyclus::Inventories inv = fleet_->SnapshotInv();
+  ReactorFleet* restored = NewFleet();
+  CopyState(fleet_, restored);
+  restored->InitInv(inv);
+
+  ASSERT_EQ(3, ncore(restored, 0));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(u0[i + 1]->obj_id(), core(restored, 0, i)->obj_id());
+  }
+  ASSERT_EQ(1, ncore(restored, 1));
+  EXPECT_EQ(u1->obj_id(), core(restored, 1, 0)->obj_id());
+  EXPECT_EQ(1, nfresh(restored));
+  EXPECT_EQ(1, CountSpent(restored, uox_));
+  EXPECT_EQ(1, CountSpent(restored, spentmox_));
+
+  // the oldest assembly is still discharged first after the restart
+  ASSERT_TRUE(Discharge(restored, 0));
+  EXPECT_EQ(2, CountSpent(restored, uox_));
+  EXPECT_EQ(u0[2]->obj_id(), core(restored, 0, 0)->obj_id());
+  delete restored;
+}
+
+}  // namespace cycamore
@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <set>
 #include <sstream>
 
 #include "cyclus.h"
+#include "datum_stage.h"
 
 using pyne::nucname::id;
 using cyclus::Composition;
@@ -107,6 +109,84 @@ TEST(ReactorTests, BatchSizes) {
   EXPECT_EQ(7+3*(simdur-1), qr.rows.size());
 }
 
+// tests that every discharged assembly has been transmuted exactly once, and
+// that assemblies transmuted to the same outrecipe share its composition.
+TEST(ReactorTests, TransmuteBatches) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  ";
+
+  int simdur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddSink("waste").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SenderId", "==", id));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(3 * (simdur - 1), qr.rows.size());
+
+  std::set<int> quals;
+  for (int i = 0; i < qr.rows.size(); i++) {
+    int resid = qr.GetVal<int>("ResourceId", i);
+    MatQuery mq(sim.GetMaterial(resid));
+    EXPECT_NEAR(1 / 101.8, mq.mass_frac(942390000), 1e-10)
+        << "assembly " << i << " was not transmuted";
+
+    std::vector<Cond> rconds;
+    rconds.push_back(Cond("ResourceId", "==", resid));
+    QueryResult rqr = sim.db().Query("Resources", &rconds);
+    quals.insert(rqr.GetVal<int>("QualId"));
+  }
+  EXPECT_EQ(1, quals.size());
+}
+
+// tests that aggregated requests order whole assemblies in power-of-two sized
+// chunks and that the reactor still cycles as with per-assembly requests.
+TEST(ReactorTests, AggregateRequests) {
+  std::string config = 
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  "
+     "  <power_cap>1</power_cap>  "
+     "  <aggregate_requests>1</aggregate_requests>  ";
+
+  int simdur = 50;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  // 4+2+1 for initial core, 2+1 per time step for each new batch
+  QueryResult qr = sim.db().Query("Transactions", NULL);
+  EXPECT_EQ(3+2*(simdur-1), qr.rows.size());
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Value", ">", 0));
+  qr = sim.db().Query("TimeSeriesPower", &conds);
+  EXPECT_EQ(simdur, qr.rows.size());
+}
+
 // tests that the refueling period between cycle end and start of the next
 // cycle is honored.
 TEST(ReactorTests, RefuelTimes) {
@@ -136,6 +216,92 @@ TEST(ReactorTests, RefuelTimes) {
   EXPECT_EQ(n_assem_want, qr.rows.size());
 }
 
+// tests that the reactor still ends cycles and records power every time step
+// while it skips the mid-cycle steps where nothing is scheduled.
+TEST(ReactorTests, MidCycleSteps) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>10</cycle_time>  "
+     "  <refuel_time>2</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>1</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  "
+     "  <power_cap>1</power_cap>  ";
+
+  int simdur = 40;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("TimeSeriesPower", &conds);
+  EXPECT_EQ(simdur, qr.rows.size());
+
+  // cycles start at 0, 12, 24 and 36
+  conds.push_back(Cond("Value", "==", 1.0));
+  qr = sim.db().Query("TimeSeriesPower", &conds);
+  EXPECT_EQ(10 + 10 + 10 + 4, qr.rows.size());
+
+  conds.clear();
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Event", "==", std::string("CYCLE_END")));
+  qr = sim.db().Query("ReactorEvents", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(10, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(22, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(34, qr.GetVal<int>("Time", 2));
+}
+
+// tests that with power_segments each run of equal power is written once and
+// the runs cover every time step.
+TEST(ReactorTests, PowerSegments) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>10</cycle_time>  "
+     "  <refuel_time>2</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>1</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  "
+     "  <power_cap>1</power_cap>  "
+     "  <power_segments>1</power_segments>  ";
+
+  int simdur = 40;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("ReactorPowerSegments", &conds);
+  // on for 0-9, 12-21, 24-33 and 36-39 and off in between
+  ASSERT_EQ(7, qr.rows.size());
+
+  int steps = 0;
+  int on = 0;
+  for (int i = 0; i < qr.rows.size(); i++) {
+    int n = qr.GetVal<int>("EndTime", i) - qr.GetVal<int>("StartTime", i) + 1;
+    steps += n;
+    if (qr.GetVal<double>("Value", i) == 1) {
+      on += n;
+    }
+  }
+  EXPECT_EQ(simdur, steps);
+  EXPECT_EQ(10 + 10 + 10 + 4, on);
+}
+
 // tests that new fuel is ordered immediately following cycle end - at the
 // start of the refueling period - not before and not after. - thie is subtly
 // different than RefuelTimes test and is not a duplicate of it.
@@ -461,6 +627,89 @@ TEST(ReactorTests, RecipeChange) {
   EXPECT_TRUE(0 < mq.mass(id("H1")));
 }
 
+// tests that reactor events are recorded with assembly counts and that
+// ignored event types are dropped.
+TEST(ReactorTests, IgnoredEvents) {
+  std::string config = 
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  "
+     "  <ignored_events> <val>TRANSMUTE</val> <val>CYCLE_END</val> </ignored_events>  ";
+
+  int simdur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Event", "==", std::string("TRANSMUTE")));
+  QueryResult qr = sim.db().Query("ReactorEvents", &conds);
+  EXPECT_EQ(0, qr.rows.size());
+
+  conds.clear();
+  conds.push_back(Cond("Event", "==", std::string("CYCLE_END")));
+  qr = sim.db().Query("ReactorEvents", &conds);
+  EXPECT_EQ(0, qr.rows.size());
+
+  conds.clear();
+  conds.push_back(Cond("Event", "==", std::string("LOAD")));
+  conds.push_back(Cond("Time", "==", 0));
+  qr = sim.db().Query("ReactorEvents", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(7, qr.GetVal<int>("Value"));
+
+  conds.clear();
+  conds.push_back(Cond("Event", "==", std::string("DISCHARGE")));
+  qr = sim.db().Query("ReactorEvents", &conds);
+  EXPECT_EQ(simdur-1, qr.rows.size());
+  EXPECT_EQ(3, qr.GetVal<int>("Value"));
+}
+
+// tests that aggregated spent fuel bids trade identical assemblies together,
+// in whole assembly quantities.
+TEST(ReactorTests, AggregateBids) {
+  std::string config = 
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>7</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  "
+     "  <aggregate_bids>1</aggregate_bids>  ";
+
+  int simdur = 10;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddSink("waste").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  Composition::Ptr spentuox = c_spentuox();
+  sim.AddRecipe("spentuox", spentuox);
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SenderId", "==", id));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  // one 3 assembly trade for each discharged batch
+  EXPECT_EQ(simdur-1, qr.rows.size());
+
+  Material::Ptr m = sim.GetMaterial(qr.GetVal<int>("ResourceId"));
+  EXPECT_DOUBLE_EQ(3, m->quantity());
+  EXPECT_EQ(spentuox->id(), m->comp()->id());
+}
+
 TEST(ReactorTests, Retire) {
   std::string config = 
      "  <fuel_inrecipes>  <val>lwr_fresh</val>  </fuel_inrecipes>  "
@@ -519,6 +768,27 @@ TEST(ReactorTests, Retire) {
       << "failed to generate power for the correct number of time steps";
 }
 
+// writes made while a stage is held must be deferred until it is released and
+// then made in the order they were staged.
+TEST(ReactorTests, DatumStage) {
+  DatumStage stage;
+  std::vector<int> written;
+
+  stage.Write([&written]() { written.push_back(1); });
+  EXPECT_EQ(1, written.size());
+
+  stage.Hold();
+  stage.Write([&written]() { written.push_back(2); });
+  stage.Write([&written]() { written.push_back(3); });
+  EXPECT_EQ(1, written.size());
+
+  stage.Release();
+  ASSERT_EQ(3, written.size());
+  EXPECT_EQ(2, written[1]);
+  EXPECT_EQ(3, written[2]);
+  EXPECT_FALSE(stage.held());
+}
+
 } // namespace reactortests
 } // namespace cycamore
 
@@ -0,0 +1,70 @@
+#ifndef CYCAMORE_SRC_RECIPE_CACHE_H_
+#define CYCAMORE_SRC_RECIPE_CACHE_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// RecipeHandle holds the composition of one recipe so that hot paths need
+/// not look the recipe up in the context by name on every call.  The recipe
+/// is resolved the first time it is asked for and again only when the name
+/// it is asked for changes (e.g. after a scheduled recipe change), so a
+/// handle stays correct however its owner's recipe state var is set.  That
+/// costs a comparison of the name on each call in place of the context's
+/// recipe map lookup; resolving only in EnterNotify would instead require
+/// every path that sets a recipe var (InitFrom, Reactor recipe changes, unit
+/// test fixtures that never call EnterNotify) to refresh the handle.
+class RecipeHandle {
+ public:
+  /// Returns the composition of recipe name.
+  cyclus::Composition::Ptr Get(cyclus::Context* ctx, const std::string& name) {
+    if (comp_.get() == NULL || name != name_) {
+      comp_ = ctx->GetRecipe(name);
+      name_ = name;
+    }
+    return comp_;
+  }
+
+  /// Drops the resolved composition so the next Get resolves it again.
+  void Reset() {
+    comp_.reset();
+    name_.clear();
+  }
+
+ private:
+  std::string name_;
+  cyclus::Composition::Ptr comp_;
+};
+
+/// RecipeHandles holds a RecipeHandle for each entry of a list of recipe
+/// names, such as a Reactor's fuel_inrecipes, indexed the same way.
+class RecipeHandles {
+ public:
+  /// Returns the composition of recipe names[i].
+  cyclus::Composition::Ptr Get(cyclus::Context* ctx,
+                               const std::vector<std::string>& names, int i) {
+    if (i < 0 || i >= names.size()) {
+      std::stringstream ss;
+      ss << "cycamore::RecipeHandles - no recipe at index " << i;
+      throw cyclus::KeyError(ss.str());
+    }
+    if (handles_.size() != names.size()) {
+      handles_.resize(names.size());
+    }
+    return handles_[i].Get(ctx, names[i]);
+  }
+
+  /// Drops every resolved composition.
+  void Reset() { handles_.clear(); }
+
+ private:
+  std::vector<RecipeHandle> handles_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_RECIPE_CACHE_H_
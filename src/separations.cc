@@ -11,7 +11,12 @@ using cyclus::CompMap;
 
 namespace cycamore {
 
-Separations::Separations(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+Separations::Separations(cyclus::Context* ctx)
+    : cyclus::Facility(ctx),
+      max_bids(0),
+      compact_streams(false),
+      record_perf(false),
+      footprint_interval(0) {}
 
 cyclus::Inventories Separations::SnapshotInv() {
   cyclus::Inventories invs;
@@ -39,6 +44,9 @@ void Separations::InitInv(cyclus::Inventories& inv) {
 
   cyclus::Inventories::iterator it;
   for (it = inv.begin(); it != inv.end(); ++it) {
+    if (it->first == "leftover-inv-name" || it->first == "feed-inv-name") {
+      continue;
+    }
     streambufs[it->first].Push(it->second);
   }
 }
@@ -95,9 +103,23 @@ void Separations::EnterNotify() {
       feed_commod_prefs.push_back(cyclus::kDefaultPref);
     }
   }
+
+  CompileStreams();
+}
+
+void Separations::CompileStreams() {
+  std::vector<std::map<int, double> > effs;
+  stream_names_.clear();
+  StreamSet::iterator it;
+  for (it = streams_.begin(); it != streams_.end(); ++it) {
+    stream_names_.push_back(it->first);
+    effs.push_back(it->second.second);
+  }
+  sep_matrix_.Compile(effs);
 }
 
 void Separations::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
   if (feed.count() == 0) {
     return;
   }
@@ -105,25 +127,26 @@ void Separations::Tick() {
   Material::Ptr mat = feed.Pop(pop_qty, cyclus::eps_rsrc());
   double orig_qty = mat->quantity();
 
-  StreamSet::iterator it;
+  if (!sep_matrix_.compiled()) {
+    CompileStreams();
+  }
+
+  std::vector<Material::Ptr> stagedsep;
+  sep_matrix_.Separate(mat, &stagedsep);
+
   double maxfrac = 1;
-  std::map<std::string, Material::Ptr> stagedsep;
-  for (it = streams_.begin(); it != streams_.end(); ++it) {
-    Stream info = it->second;
-    std::string name = it->first;
-    stagedsep[name] = SepMaterial(info.second, mat);
-    double frac = streambufs[name].space() / stagedsep[name]->quantity();
+  for (int i = 0; i < stagedsep.size(); ++i) {
+    double frac =
+        streambufs[stream_names_[i]].space() / stagedsep[i]->quantity();
     if (frac < maxfrac) {
       maxfrac = frac;
     }
   }
 
-  std::map<std::string, Material::Ptr>::iterator itf;
-  for (itf = stagedsep.begin(); itf != stagedsep.end(); ++itf) {
-    std::string name = itf->first;
-    Material::Ptr m = itf->second;
+  for (int i = 0; i < stagedsep.size(); ++i) {
+    Material::Ptr m = stagedsep[i];
     if (m->quantity() > 0) {
-      streambufs[name].Push(
+      streambufs[stream_names_[i]].Push(
           mat->ExtractComp(m->quantity() * maxfrac, m->comp()));
     }
   }
@@ -145,7 +168,8 @@ void Separations::Tick() {
 
 // Note that this returns an untracked material that should just be used for
 // its composition and qty - not in any real inventories, etc.
-Material::Ptr SepMaterial(std::map<int, double> effs, Material::Ptr mat) {
+Material::Ptr SepMaterial(const std::map<int, double>& effs,
+                          Material::Ptr mat) {
   CompMap cm = mat->comp()->mass();
   cyclus::compmath::Normalize(&cm, mat->quantity());
   double tot_qty = 0;
@@ -155,17 +179,16 @@ Material::Ptr SepMaterial(std::map<int, double> effs, Material::Ptr mat) {
   for (it = cm.begin(); it != cm.end(); ++it) {
     int nuc = it->first;
     int elem = (nuc / 10000000) * 10000000;
-    double eff = 0;
-    if (effs.count(nuc) > 0) {
-      eff = effs[nuc];
-    } else if (effs.count(elem) > 0) {
-      eff = effs[elem];
-    } else {
-      continue;
+    std::map<int, double>::const_iterator eff = effs.find(nuc);
+    if (eff == effs.end()) {
+      eff = effs.find(elem);
+      if (eff == effs.end()) {
+        continue;
+      }
     }
 
     double qty = it->second;
-    double sepqty = qty * eff;
+    double sepqty = qty * eff->second;
     sepcomp[nuc] = sepqty;
     tot_qty += sepqty;
   }
@@ -174,8 +197,130 @@ Material::Ptr SepMaterial(std::map<int, double> effs, Material::Ptr mat) {
   return Material::CreateUntracked(tot_qty, c);
 };
 
+// covers every element in the periodic table by atomic number
+static const int kMaxZ = 119;
+
+SepMatrix::SepMatrix(int max_size)
+    : compiled_(false), nstreams_(0), max_size_(max_size), hits_(0),
+      misses_(0) {}
+
+void SepMatrix::Compile(const std::vector<std::map<int, double> >& effs) {
+  nstreams_ = effs.size();
+  elem_effs_.assign(kMaxZ * nstreams_, -1);
+  nuc_effs_.clear();
+  cache_.clear();
+
+  std::map<int, double>::const_iterator it;
+  for (int s = 0; s < nstreams_; ++s) {
+    for (it = effs[s].begin(); it != effs[s].end(); ++it) {
+      int key = it->first;
+      int z = key / 10000000;
+      if (key % 10000000 == 0 && z >= 0 && z < kMaxZ) {
+        elem_effs_[z * nstreams_ + s] = it->second;
+      } else {
+        std::vector<double>& row = nuc_effs_[key];
+        row.resize(nstreams_, -1);
+        row[s] = it->second;
+      }
+    }
+  }
+
+  // streams that don't name a nuclide directly fall back to its element
+  std::map<int, std::vector<double> >::iterator nit;
+  for (nit = nuc_effs_.begin(); nit != nuc_effs_.end(); ++nit) {
+    int z = nit->first / 10000000;
+    if (z < 0 || z >= kMaxZ) {
+      continue;
+    }
+    for (int s = 0; s < nstreams_; ++s) {
+      if (nit->second[s] < 0) {
+        nit->second[s] = elem_effs_[z * nstreams_ + s];
+      }
+    }
+  }
+  compiled_ = true;
+}
+
+const double* SepMatrix::Row(int nuc) const {
+  if (!nuc_effs_.empty()) {
+    std::map<int, std::vector<double> >::const_iterator it =
+        nuc_effs_.find(nuc);
+    if (it != nuc_effs_.end()) {
+      return &it->second[0];
+    }
+  }
+  int z = nuc / 10000000;
+  if (z < 0 || z >= kMaxZ) {
+    return NULL;
+  }
+  return &elem_effs_[z * nstreams_];
+}
+
+void SepMatrix::Separate(Material::Ptr mat, std::vector<Material::Ptr>* sep) {
+  if (nstreams_ == 0) {
+    sep->clear();
+    return;
+  }
+  sep->resize(nstreams_);
+
+  double qty = mat->quantity();
+  int comp_id = mat->comp()->id();
+  std::map<int, Entry>::iterator cit = cache_.find(comp_id);
+  if (cit != cache_.end()) {
+    hits_++;
+    const Entry& e = cit->second;
+    for (int s = 0; s < nstreams_; ++s) {
+      (*sep)[s] = Material::CreateUntracked(e.fracs[s] * qty, e.comps[s]);
+    }
+    return;
+  }
+  misses_++;
+
+  // separate a unit quantity of feed so the result can be reused for any
+  // quantity of the same composition
+  const CompMap& cm = mat->comp()->mass();
+  CompMap::const_iterator it;
+  double norm = 0;
+  for (it = cm.begin(); it != cm.end(); ++it) {
+    norm += it->second;
+  }
+  norm = norm > 0 ? 1 / norm : 0;
+
+  std::vector<CompMap> sepcomps(nstreams_);
+  std::vector<double> fracs(nstreams_, 0);
+  for (it = cm.begin(); it != cm.end(); ++it) {
+    const double* row = Row(it->first);
+    if (row == NULL) {
+      continue;
+    }
+    double frac = it->second * norm;
+    for (int s = 0; s < nstreams_; ++s) {
+      if (row[s] < 0) {
+        continue;
+      }
+      double sepfrac = frac * row[s];
+      sepcomps[s][it->first] = sepfrac;
+      fracs[s] += sepfrac;
+    }
+  }
+
+  // mixed feed creates new compositions - don't let them accumulate forever.
+  if (static_cast<int>(cache_.size()) >= max_size_) {
+    cache_.clear();
+  }
+
+  Entry& e = cache_[comp_id];
+  e.fracs = fracs;
+  e.comps.resize(nstreams_);
+  for (int s = 0; s < nstreams_; ++s) {
+    e.comps[s] = Composition::CreateFromMass(sepcomps[s]);
+    (*sep)[s] = Material::CreateUntracked(fracs[s] * qty, e.comps[s]);
+  }
+}
+
 std::set<cyclus::RequestPortfolio<Material>::Ptr>
 Separations::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::RequestPortfolio;
   std::set<RequestPortfolio<Material>::Ptr> ports;
 
@@ -192,7 +337,7 @@ Separations::GetMatlRequests() {
 
   Material::Ptr m = cyclus::NewBlankMaterial(feed.space());
   if (!feed_recipe.empty()) {
-    Composition::Ptr c = context()->GetRecipe(feed_recipe);
+    Composition::Ptr c = feed_rec_.Get(context(), feed_recipe);
     m = Material::CreateUntracked(feed.space(), c);
   }
 
@@ -205,6 +350,7 @@ Separations::GetMatlRequests() {
   port->AddMutualReqs(reqs);
   ports.insert(port);
 
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
   return ports;
 }
 
@@ -212,6 +358,8 @@ void Separations::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
   using cyclus::Trade;
 
   std::vector<cyclus::Trade<cyclus::Material> >::const_iterator it;
@@ -235,6 +383,8 @@ void Separations::GetMatlTrades(
 void Separations::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -245,88 +395,141 @@ void Separations::AcceptMatlTrades(
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> Separations::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
   using cyclus::BidPortfolio;
 
-  bool exclusive = false;
   std::set<BidPortfolio<Material>::Ptr> ports;
 
   // bid streams
   std::map<std::string, ResBuf<Material> >::iterator it;
   for (it = streambufs.begin(); it != streambufs.end(); ++it) {
     std::string commod = it->first;
-    std::vector<Request<Material>*>& reqs = commod_requests[commod];
-    if (reqs.size() == 0) {
-      continue;
-    } else if (streambufs[commod].quantity() < cyclus::eps_rsrc()) {
-      continue;
+    BidPortfolio<Material>::Ptr port =
+        BidBuffer_(&it->second, commod_requests[commod]);
+    if (port.get() != NULL) {
+      ports.insert(port);
     }
+  }
 
-    MatVec mats = streambufs[commod].PopN(streambufs[commod].count());
-    streambufs[commod].Push(mats);
+  // bid leftovers
+  BidPortfolio<Material>::Ptr port =
+      BidBuffer_(&leftover, commod_requests[leftover_commod]);
+  if (port.get() != NULL) {
+    ports.insert(port);
+  }
 
-    BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
+  return ports;
+}
 
-    for (int j = 0; j < reqs.size(); j++) {
-      Request<Material>* req = reqs[j];
-      double tot_bid = 0;
-      for (int k = 0; k < mats.size(); k++) {
-        Material::Ptr m = mats[k];
-        tot_bid += m->quantity();
+cyclus::BidPortfolio<Material>::Ptr Separations::BidBuffer_(
+    ResBuf<Material>* buf, const std::vector<Request<Material>*>& reqs) {
+  using cyclus::BidPortfolio;
 
-        // this fix the problem of the cyclus exchange manager which crashes
-        // when a bid with a quantity <=0 is offered.
-        if (m->quantity() > cyclus::eps_rsrc()) {
-          port->AddBid(req, m, this, exclusive);
-        }
+  bool exclusive = false;
+  if (reqs.size() == 0 || buf->quantity() < cyclus::eps_rsrc()) {
+    return BidPortfolio<Material>::Ptr();
+  }
 
-        if (tot_bid >= req->target()->quantity()) {
-          break;
-        }
-      }
+  // compacted view of the buffer: one untracked material per distinct
+  // composition, in order of first appearance.  Trades pop by quantity, so
+  // offers need not be the buffered materials themselves.
+  MatVec mats = buf->PopN(buf->count());
+  buf->Push(mats);
+  std::map<int, int> index;
+  MatVec view;
+  for (int k = 0; k < mats.size(); k++) {
+    Material::Ptr m = mats[k];
+    std::map<int, int>::iterator idx = index.find(m->comp()->id());
+    if (idx == index.end()) {
+      index[m->comp()->id()] = view.size();
+      view.push_back(Material::CreateUntracked(m->quantity(), m->comp()));
+    } else {
+      view[idx->second]->Absorb(
+          Material::CreateUntracked(m->quantity(), m->comp()));
     }
+  }
 
-    double tot_qty = streambufs[commod].quantity();
-    cyclus::CapacityConstraint<Material> cc(tot_qty);
-    port->AddConstraint(cc);
-    ports.insert(port);
+  // if there are more compositions than bids allowed per request, offer
+  // only the oldest ones
+  if (max_bids > 0 && static_cast<int>(view.size()) > max_bids) {
+    view.resize(max_bids);
   }
 
-  // bid leftovers
-  std::vector<Request<Material>*>& reqs = commod_requests[leftover_commod];
-  if (reqs.size() > 0 && leftover.quantity() >= cyclus::eps_rsrc()) {
-    MatVec mats = leftover.PopN(leftover.count());
-    leftover.Push(mats);
-
-    BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
-
-    for (int j = 0; j < reqs.size(); j++) {
-      Request<Material>* req = reqs[j];
-      double tot_bid = 0;
-      for (int k = 0; k < mats.size(); k++) {
-        Material::Ptr m = mats[k];
-        tot_bid += m->quantity();
-
-        // this fix the problem of the cyclus exchange manager which crashes
-        // when a bid with a quantity <=0 is offered.
-        if (m->quantity() > cyclus::eps_rsrc()) {
-          port->AddBid(req, m, this, exclusive);
-        }
-
-        if (tot_bid >= req->target()->quantity()) {
-          break;
-        }
+  BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
+  for (int j = 0; j < reqs.size(); j++) {
+    Request<Material>* req = reqs[j];
+    double tot_bid = 0;
+    for (int k = 0; k < view.size(); k++) {
+      Material::Ptr m = view[k];
+      tot_bid += m->quantity();
+
+      // this fix the problem of the cyclus exchange manager which crashes
+      // when a bid with a quantity <=0 is offered.
+      if (m->quantity() > cyclus::eps_rsrc()) {
+        port->AddBid(req, m, this, exclusive);
+      }
+
+      if (tot_bid >= req->target()->quantity()) {
+        break;
       }
     }
+  }
 
-    cyclus::CapacityConstraint<Material> cc(leftover.quantity());
-    port->AddConstraint(cc);
-    ports.insert(port);
+  cyclus::CapacityConstraint<Material> cc(buf->quantity());
+  port->AddConstraint(cc);
+  return port;
+}
+
+void Separations::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  RecordFootprint_();
+  LOG(cyclus::LEV_INFO4, "SepFac") << prototype() << " separation cache: "
+                                   << sep_matrix_.hits() << " hits, "
+                                   << sep_matrix_.misses() << " misses";
+  if (!compact_streams) {
+    return;
   }
 
-  return ports;
+  std::map<std::string, ResBuf<Material> >::iterator it;
+  for (it = streambufs.begin(); it != streambufs.end(); ++it) {
+    CompactBuffer_(&it->second);
+  }
+  CompactBuffer_(&leftover);
+}
+
+void Separations::RecordFootprint_() {
+  if (!InventoryFootprint::Due(footprint_interval, context()->time())) {
+    return;
+  }
+  InventoryFootprint fp;
+  fp.AddBuf("feed", &feed);
+  fp.AddBuf("leftover", &leftover);
+  std::map<std::string, ResBuf<Material> >::iterator it;
+  for (it = streambufs.begin(); it != streambufs.end(); ++it) {
+    fp.AddBuf("streambufs:" + it->first, &it->second);
+  }
+  fp.Record(this);
 }
 
-void Separations::Tock() {}
+void Separations::CompactBuffer_(ResBuf<Material>* buf) {
+  if (buf->count() < 2) {
+    return;
+  }
+
+  // trades pop by quantity from the front, so merging only neighbours keeps
+  // what each trade receives unchanged
+  MatVec mats = buf->PopN(buf->count());
+  MatVec merged;
+  for (int k = 0; k < mats.size(); k++) {
+    if (!merged.empty() && merged.back()->comp() == mats[k]->comp()) {
+      merged.back()->Absorb(mats[k]);
+    } else {
+      merged.push_back(mats[k]);
+    }
+  }
+  buf->Push(merged);
+}
 
 bool Separations::CheckDecommissionCondition() {
   if (leftover.count() > 0) {
@@ -3,6 +3,10 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "inventory_footprint.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
@@ -13,9 +17,60 @@ namespace cycamore {
 /// separations efficiency for that nuclide or element.  Note that this returns
 /// an untracked material that should only be used for its composition and qty
 /// - not in any real inventories, etc.
-cyclus::Material::Ptr SepMaterial(std::map<int, double> effs,
+cyclus::Material::Ptr SepMaterial(const std::map<int, double>& effs,
                                   cyclus::Material::Ptr mat);
 
+/// SepMatrix is a compiled form of the efficiencies of a set of separations
+/// streams.  Element efficiencies are held in a dense (element x stream) table
+/// and nuclide-specific efficiencies in per-nuclide rows that already have the
+/// element efficiencies of the other streams resolved into them.  Separating a
+/// material into every stream then takes a single pass over its composition
+/// with one row lookup per nuclide.
+///
+/// Separated compositions and their mass fractions of the feed are also
+/// memoized keyed on feed composition id, so repeated feed (e.g. spent fuel
+/// from reactors sharing an outrecipe) skips the nuclide loop entirely.
+class SepMatrix {
+ public:
+  SepMatrix(int max_size = 1000);
+
+  /// Compiles the given per-stream efficiencies (in the same form as the
+  /// effs argument of SepMaterial).  Stream indices follow the order of effs.
+  void Compile(const std::vector<std::map<int, double> >& effs);
+
+  bool compiled() const { return compiled_; }
+  int nstreams() const { return nstreams_; }
+
+  /// Separates mat into every stream at once, filling sep with one untracked
+  /// material per stream with the same semantics as SepMaterial.
+  void Separate(cyclus::Material::Ptr mat,
+                std::vector<cyclus::Material::Ptr>* sep);
+
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    std::vector<cyclus::Composition::Ptr> comps;
+    std::vector<double> fracs;
+  };
+
+  /// @return the per-stream efficiencies for nuc, where a negative entry
+  /// means that stream does not separate nuc at all, or NULL if no stream
+  /// separates nuc.
+  const double* Row(int nuc) const;
+
+  bool compiled_;
+  int nstreams_;
+  std::vector<double> elem_effs_;
+  std::map<int, std::vector<double> > nuc_effs_;
+
+  int max_size_;
+  int hits_;
+  int misses_;
+  std::map<int, Entry> cache_;
+};
+
 /// Separations processes feed material into one or more streams containing
 /// specific elements and/or nuclides.  It uses mass-based efficiencies.
 ///
@@ -34,7 +89,8 @@ cyclus::Material::Ptr SepMaterial(std::map<int, double> effs,
 /// reduce its stocks by trading and hits this limit for any of its output
 /// streams, further processing/separations of feed material will halt until
 /// room is again available in the output streams.
-class Separations : public cyclus::Facility {
+class Separations : public cyclus::Facility,
+                    public ConcurrentTimeListener {
 #pragma cyclus note { \
   "niche": "separations", \
   "doc": \
@@ -101,6 +157,10 @@ class Separations : public cyclus::Facility {
   virtual void InitInv(cyclus::Inventories& inv);
 
  private:
+  /// merges consecutive materials of equal composition in buf, keeping their
+  /// order
+  void CompactBuffer_(cyclus::toolkit::ResBuf<cyclus::Material>* buf);
+
   #pragma cyclus var { \
     "doc": "Ordered list of commodities on which to request feed material to " \
            "separate. Order only matters for matching up with feed commodity " \
@@ -175,6 +235,60 @@ class Separations : public cyclus::Facility {
   }
   double leftoverbuf_size;
 
+  #pragma cyclus var { \
+    "doc" : "Maximum number of bids offered from a single output buffer " \
+            "(a separations stream or the leftover stream) per request. " \
+            "Materials of equal composition are always offered together; " \
+            "if there are more distinct compositions than this, only the " \
+            "oldest are offered and the rest wait for a later time step. " \
+            "Zero or negative values (the default) mean no limit.", \
+    "uilabel": "Maximum Bids per Request", \
+    "default": 0, \
+  }
+  int max_bids;
+
+  #pragma cyclus var { \
+    "doc" : "If true, consecutive materials of equal composition in each " \
+            "stream and leftover buffer are merged into one at the end of " \
+            "every time step, so long-lived buffers hold (and snapshot) a " \
+            "handful of materials instead of one per time step.", \
+    "uilabel": "Compact Stream Buffers", \
+    "default": False, \
+    "userlevel": 10, \
+  }
+  bool compact_streams;
+
+  #pragma cyclus var { \
+    "doc" : "If true, the wall time of each time step and exchange " \
+            "callback, and the number of requests, bids or trades it " \
+            "handled, are recorded to the ArchetypePerf table every time " \
+            "step.", \
+    "uilabel": "Record Performance", \
+    "default": False, \
+    "userlevel": 10, \
+  }
+  bool record_perf;
+
+  #pragma cyclus var { \
+    "doc" : "If positive, the number of material objects, total quantity " \
+            "and number of distinct compositions held in the feed, leftover " \
+            "and each stream buffer are recorded to the InventoryFootprint " \
+            "table every this many time steps.", \
+    "uilabel": "Inventory Footprint Interval", \
+    "default": 0, \
+    "userlevel": 10, \
+  }
+  int footprint_interval;
+
+  // records the inventory footprint if one is due this time step
+  void RecordFootprint_();
+
+  // per-phase timings for the current time step
+  ArchetypePerf perf_;
+
+  // resolved feed_recipe
+  RecipeHandle feed_rec_;
+
  #pragma cyclus var { \
     "capacity" : "leftoverbuf_size", \
   }
@@ -203,6 +317,22 @@ class Separations : public cyclus::Facility {
   // custom SnapshotInv and InitInv and EnterNotify are used to persist this
   // state var.
   std::map<std::string, cyclus::toolkit::ResBuf<cyclus::Material> > streambufs;
+
+  // streams_ efficiencies compiled in EnterNotify (or lazily on first use);
+  // stream indices follow the (sorted) order of streams_
+  SepMatrix sep_matrix_;
+  std::vector<std::string> stream_names_;
+
+  void CompileStreams();
+
+  /// Bids the contents of buf on each of reqs, returning a NULL portfolio if
+  /// there is nothing to bid on.
+  cyclus::BidPortfolio<cyclus::Material>::Ptr BidBuffer_(
+      cyclus::toolkit::ResBuf<cyclus::Material>* buf,
+      const std::vector<cyclus::Request<cyclus::Material>*>& reqs);
+
+  friend class SeparationsTest;
+  friend class CallbackBench;
 };
 
 }  // namespace cycamore
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include "cyclus.h"
+#include "test_context.h"
 
 using pyne::nucname::id;
 using cyclus::Composition;
@@ -14,6 +15,30 @@ using cyclus::toolkit::MatQuery;
 
 namespace cycamore {
 
+class SeparationsTest : public ::testing::Test {
+ public:
+  typedef cyclus::toolkit::ResBuf<cyclus::Material> InvBuffer;
+
+  cyclus::TestContext tc_;
+  Separations* sep_;
+
+  virtual void SetUp() { sep_ = new Separations(tc_.get()); }
+  virtual void TearDown() { delete sep_; }
+
+  InvBuffer& streambuf(const std::string& name) {
+    return sep_->streambufs[name];
+  }
+  void compact_streams(bool compact) { sep_->compact_streams = compact; }
+  InvBuffer& leftover() { return sep_->leftover; }
+  InvBuffer& feed() { return sep_->feed; }
+  int nstreambufs() { return sep_->streambufs.size(); }
+  void max_bids(int n) { sep_->max_bids = n; }
+  cyclus::BidPortfolio<Material>::Ptr BidBuffer(
+      InvBuffer* buf, const std::vector<cyclus::Request<Material>*>& reqs) {
+    return sep_->BidBuffer_(buf, reqs);
+  }
+};
+
 TEST(SeparationsTests, SepMaterial) {
   CompMap comp;
   comp[id("U235")] = 10;
@@ -43,7 +68,64 @@ TEST(SeparationsTests, SepMaterial) {
   EXPECT_DOUBLE_EQ(0, mqsep.mass("Am242"));
 }
 
-  
+
+TEST(SeparationsTests, SepMatrix) {
+  CompMap comp;
+  comp[id("U235")] = 10;
+  comp[id("U238")] = 90;
+  comp[id("Pu239")] = 1;
+  comp[id("Pu240")] = 2;
+  comp[id("Am241")] = 3;
+  comp[id("Am242")] = 2.8;
+  comp[id("Cs137")] = 1.5;
+  Composition::Ptr c = Composition::CreateFromMass(comp);
+  Material::Ptr mat = Material::CreateUntracked(100, c);
+
+  std::vector<std::map<int, double> > effs(3);
+  effs[0][id("U")] = .7;
+  effs[0][id("Pu")] = .4;
+  effs[0][id("Am241")] = .4;
+  effs[1][id("Am")] = .5;
+  effs[1][id("Pu239")] = .3;
+  effs[2][id("Pu")] = .2;
+
+  SepMatrix sm;
+  EXPECT_FALSE(sm.compiled());
+  sm.Compile(effs);
+  ASSERT_TRUE(sm.compiled());
+  ASSERT_EQ(3, sm.nstreams());
+
+  std::vector<Material::Ptr> seps;
+  sm.Separate(mat, &seps);
+  ASSERT_EQ(3, seps.size());
+
+  const char* nucs[] = {"U235", "U238", "Pu239", "Pu240", "Am241", "Am242",
+                        "Cs137"};
+  for (int i = 0; i < effs.size(); ++i) {
+    Material::Ptr want = SepMaterial(effs[i], mat);
+    MatQuery mqwant(want);
+    MatQuery mqgot(seps[i]);
+    EXPECT_NEAR(want->quantity(), seps[i]->quantity(), 1e-10);
+    for (int j = 0; j < 7; ++j) {
+      EXPECT_NEAR(mqwant.mass(nucs[j]), mqgot.mass(nucs[j]), 1e-10)
+          << "stream " << i << " nuclide " << nucs[j];
+    }
+  }
+  EXPECT_EQ(0, sm.hits());
+  EXPECT_EQ(1, sm.misses());
+
+  // repeated feed composition reuses the separated compositions
+  Material::Ptr mat2 = Material::CreateUntracked(40, c);
+  std::vector<Material::Ptr> seps2;
+  sm.Separate(mat2, &seps2);
+  EXPECT_EQ(1, sm.hits());
+  EXPECT_EQ(1, sm.misses());
+  for (int i = 0; i < effs.size(); ++i) {
+    EXPECT_EQ(seps[i]->comp(), seps2[i]->comp());
+    EXPECT_NEAR(seps[i]->quantity() * 0.4, seps2[i]->quantity(), 1e-10);
+  }
+}
+
 // Check that cumulative separations efficiency for a single nuclide of less than or equal to one does not trigger an error.
 TEST(SeparationsTests, SeparationEfficiency) {
 
@@ -281,6 +363,145 @@ TEST(SeparationsTests, SepMixElemAndNuclide) {
   EXPECT_DOUBLE_EQ(0, mq.mass("Pu240"));
 }
 
+TEST(SeparationsTests, CompactStreams) {
+  // merging stream materials must not change what is traded away
+  std::string config =
+      "<streams>"
+      "    <item>"
+      "        <commod>stream1</commod>"
+      "        <info>"
+      "            <buf_size>-1</buf_size>"
+      "            <efficiencies>"
+      "                <item><comp>U235</comp> <eff>1.0</eff></item>"
+      "            </efficiencies>"
+      "        </info>"
+      "    </item>"
+      "</streams>"
+      ""
+      "<leftover_commod>waste</leftover_commod>"
+      "<throughput>100</throughput>"
+      "<feedbuf_size>100</feedbuf_size>"
+      "<feed_commods> <val>feed</val> </feed_commods>"
+      "<compact_streams>1</compact_streams>"
+     ;
+
+  CompMap m;
+  m[id("u235")] = 0.1;
+  m[id("u238")] = 0.9;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+
+  int simdur = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Separations"),
+                      config, simdur);
+  sim.AddSource("feed").recipe("recipe1").Finalize();
+  sim.AddSink("stream1").capacity(5).Finalize();
+  sim.AddRecipe("recipe1", c);
+  int agent_id = sim.Run();
+
+  // 10 kg of U235 is separated each time step from t=1, and 5 kg is taken
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SenderId", "==", agent_id));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(simdur - 1, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); i++) {
+    Material::Ptr mat = sim.GetMaterial(qr.GetVal<int>("ResourceId", i));
+    EXPECT_DOUBLE_EQ(5, mat->quantity());
+    EXPECT_DOUBLE_EQ(1, MatQuery(mat).mass_frac(id("u235")));
+  }
+}
+
+TEST_F(SeparationsTest, CompactBuffers) {
+  // consecutive stream materials of equal composition are merged on Tock,
+  // and only when compact_streams is set
+  CompMap m;
+  m[id("u235")] = 1;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+  m[id("u238")] = 1;
+  Composition::Ptr c2 = Composition::CreateFromMass(m);
+
+  InvBuffer& buf = streambuf("stream1");
+  buf.Push(Material::CreateUntracked(1, c));
+  buf.Push(Material::CreateUntracked(1, c));
+  buf.Push(Material::CreateUntracked(1, c2));
+  buf.Push(Material::CreateUntracked(1, c));
+
+  sep_->Tock();
+  EXPECT_EQ(4, buf.count());
+
+  compact_streams(true);
+  sep_->Tock();
+  ASSERT_EQ(3, buf.count());
+  EXPECT_DOUBLE_EQ(4, buf.quantity());
+  EXPECT_DOUBLE_EQ(2, buf.Peek()->quantity());
+}
+
+TEST_F(SeparationsTest, MaxBids) {
+  // a buffer holding more compositions than max_bids offers only its oldest
+  // max_bids compositions per request and keeps the rest buffered; with the
+  // default of no limit every composition is offered
+  using cyclus::Bid;
+  using cyclus::BidPortfolio;
+  using cyclus::Request;
+
+  max_bids(3);
+  InvBuffer& buf = streambuf("stream1");
+  for (int i = 1; i <= 5; i++) {
+    CompMap m;
+    m[id("u235")] = i;
+    m[id("u238")] = 10;
+    buf.Push(Material::CreateUntracked(i, Composition::CreateFromMass(m)));
+  }
+
+  CompMap t;
+  t[id("u235")] = 1;
+  Material::Ptr target =
+      Material::CreateUntracked(100, Composition::CreateFromMass(t));
+  std::vector<Request<Material>*> reqs;
+  reqs.push_back(Request<Material>::Create(target, tc_.trader(), "stream1"));
+
+  BidPortfolio<Material>::Ptr port = BidBuffer(&buf, reqs);
+  ASSERT_TRUE(port.get() != NULL);
+  const std::set<Bid<Material>*>& bids = port->bids();
+  EXPECT_EQ(3, bids.size());
+  std::set<double> qtys;
+  std::set<Bid<Material>*>::const_iterator it;
+  for (it = bids.begin(); it != bids.end(); ++it) {
+    qtys.insert((*it)->offer()->quantity());
+  }
+  std::set<double> want;
+  want.insert(1);
+  want.insert(2);
+  want.insert(3);
+  EXPECT_EQ(want, qtys);
+  EXPECT_EQ(5, buf.count());
+
+  max_bids(0);
+  port = BidBuffer(&buf, reqs);
+  ASSERT_TRUE(port.get() != NULL);
+  EXPECT_EQ(5, port->bids().size());
+}
+
+TEST_F(SeparationsTest, RestoreInventories) {
+  // a restart must restore the leftover and feed inventories into their own
+  // buffers rather than into stream buffers named after them
+  CompMap m;
+  m[id("u235")] = 1;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+  streambuf("stream1").Push(Material::CreateUntracked(1, c));
+  leftover().Push(Material::CreateUntracked(2, c));
+  feed().Push(Material::CreateUntracked(3, c));
+
+  cyclus::Inventories inv = sep_->SnapshotInv();
+  delete sep_;
+  sep_ = new Separations(tc_.get());
+  sep_->InitInv(inv);
+
+  EXPECT_EQ(1, nstreambufs());
+  EXPECT_DOUBLE_EQ(1, streambuf("stream1").quantity());
+  EXPECT_DOUBLE_EQ(2, leftover().quantity());
+  EXPECT_DOUBLE_EQ(3, feed().quantity());
+}
+
 TEST(SeparationsTests, Retire) {
   std::string config =
       "<streams>"
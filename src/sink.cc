@@ -1,5 +1,6 @@
 // Implements the Sink class
 #include <algorithm>
+#include <map>
 #include <sstream>
 
 #include <boost/lexical_cast.hpp>
@@ -11,7 +12,10 @@ namespace cycamore {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Sink::Sink(cyclus::Context* ctx)
     : cyclus::Facility(ctx),
-      capacity(std::numeric_limits<double>::max()) {
+      capacity(std::numeric_limits<double>::max()),
+      absorb_inventory(false),
+      record_perf(false),
+      footprint_interval(0) {
   SetMaxInventorySize(std::numeric_limits<double>::max());
 }
 
@@ -76,24 +80,26 @@ std::string Sink::str() {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Sink::GetMatlRequests() {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_REQUESTS, this);
   using cyclus::Material;
   using cyclus::RequestPortfolio;
   using cyclus::Request;
   using cyclus::Composition;
 
   std::set<RequestPortfolio<Material>::Ptr> ports;
-  RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
   double amt = RequestAmt();
-  Material::Ptr mat;
-
-  if (recipe_name.empty()) {
-    mat = cyclus::NewBlankMaterial(amt);
-  } else {
-    Composition::Ptr rec = this->context()->GetRecipe(recipe_name);
-    mat = cyclus::Material::CreateUntracked(amt, rec); 
-  } 
 
   if (amt > cyclus::eps()) {
+    RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
+    Material::Ptr mat;
+    if (recipe_name.empty()) {
+      mat = cyclus::NewBlankMaterial(amt);
+    } else {
+      Composition::Ptr rec = recipe_.Get(context(), recipe_name);
+      mat = cyclus::Material::CreateUntracked(amt, rec);
+    }
+
+    // the same target material is shared by every commodity request
     std::vector<Request<Material>*> mutuals;
     for (int i = 0; i < in_commods.size(); i++) {
       mutuals.push_back(port->AddRequest(mat, this, in_commods[i], in_commod_prefs[i]));
@@ -102,6 +108,7 @@ Sink::GetMatlRequests() {
     ports.insert(port);
   }  // if amt > eps
 
+  scope.Count(ArchetypePerf::NRequests<Material>(ports));
   return ports;
 }
 
@@ -114,18 +121,19 @@ Sink::GetGenRsrcRequests() {
   using cyclus::Request;
 
   std::set<RequestPortfolio<Product>::Ptr> ports;
-  RequestPortfolio<Product>::Ptr
-      port(new RequestPortfolio<Product>());
   double amt = RequestAmt();
 
   if (amt > cyclus::eps()) {
+    RequestPortfolio<Product>::Ptr
+        port(new RequestPortfolio<Product>());
     CapacityConstraint<Product> cc(amt);
     port->AddConstraint(cc);
 
+    // the same target product is shared by every commodity request
+    std::string quality = "";  // not clear what this should be..
+    Product::Ptr rsrc = Product::CreateUntracked(amt, quality);
     std::vector<std::string>::const_iterator it;
     for (it = in_commods.begin(); it != in_commods.end(); ++it) {
-      std::string quality = "";  // not clear what this should be..
-      Product::Ptr rsrc = Product::CreateUntracked(amt, quality);
       port->AddRequest(rsrc, this, *it);
     }
 
@@ -139,11 +147,15 @@ Sink::GetGenRsrcRequests() {
 void Sink::AcceptMatlTrades(
     const std::vector< std::pair<cyclus::Trade<cyclus::Material>,
                                  cyclus::Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_ACCEPT_MATL_TRADES, this);
+  scope.Count(responses.size());
   std::vector< std::pair<cyclus::Trade<cyclus::Material>,
                          cyclus::Material::Ptr> >::const_iterator it;
+  std::vector<cyclus::Resource::Ptr> rs;
   for (it = responses.begin(); it != responses.end(); ++it) {
-    inventory.Push(it->second);
+    rs.push_back(it->second);
   }
+  Store_(rs);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -152,13 +164,66 @@ void Sink::AcceptGenRsrcTrades(
                                  cyclus::Product::Ptr> >& responses) {
   std::vector< std::pair<cyclus::Trade<cyclus::Product>,
                          cyclus::Product::Ptr> >::const_iterator it;
+  std::vector<cyclus::Resource::Ptr> rs;
   for (it = responses.begin(); it != responses.end(); ++it) {
+    rs.push_back(it->second);
+  }
+  Store_(rs);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Sink::Store_(const std::vector<cyclus::Resource::Ptr>& rs) {
+  using cyclus::Material;
+  using cyclus::Product;
+  using cyclus::Resource;
+  using cyclus::ResCast;
+
+  if (!absorb_inventory) {
+    for (int i = 0; i < rs.size(); ++i) {
+      inventory.Push(rs[i]);
+    }
+    return;
+  }
+
+  // in absorbing mode the inventory only ever holds one material and one
+  // product per quality, so popping it all is cheap
+  std::vector<Resource::Ptr> held = inventory.PopN(inventory.count());
+  std::vector<Resource::Ptr> all(held);
+  all.insert(all.end(), rs.begin(), rs.end());
+
+  Material::Ptr mat;
+  std::map<std::string, Product::Ptr> prods;
+  for (int i = 0; i < all.size(); ++i) {
+    if (all[i]->type() == Material::kType) {
+      Material::Ptr m = ResCast<Material>(all[i]);
+      if (mat.get() == NULL) {
+        mat = m;
+      } else {
+        mat->Absorb(m);
+      }
+    } else {
+      Product::Ptr p = ResCast<Product>(all[i]);
+      Product::Ptr& held_p = prods[p->quality()];
+      if (held_p.get() == NULL) {
+        held_p = p;
+      } else {
+        held_p->Absorb(p);
+      }
+    }
+  }
+
+  if (mat.get() != NULL) {
+    inventory.Push(mat);
+  }
+  std::map<std::string, Product::Ptr>::iterator it;
+  for (it = prods.begin(); it != prods.end(); ++it) {
     inventory.Push(it->second);
   }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Sink::Tick() {
+  PerfScope scope(&perf_, record_perf, PERF_TICK, this);
   using std::string;
   using std::vector;
   LOG(cyclus::LEV_INFO3, "SnkFac") << prototype() << " is ticking {";
@@ -178,6 +243,8 @@ void Sink::Tick() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Sink::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+  RecordFootprint_();
   LOG(cyclus::LEV_INFO3, "SnkFac") << prototype() << " is tocking {";
 
   // On the tock, the sink facility doesn't really do much.
@@ -190,6 +257,16 @@ void Sink::Tock() {
   LOG(cyclus::LEV_INFO3, "SnkFac") << "}";
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Sink::RecordFootprint_() {
+  if (!InventoryFootprint::Due(footprint_interval, context()->time())) {
+    return;
+  }
+  InventoryFootprint fp;
+  fp.AddBuf("inventory", &inventory);
+  fp.Record(this);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 extern "C" cyclus::Agent* ConstructSink(cyclus::Context* ctx) {
   return new Sink(ctx);
@@ -8,6 +8,10 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "inventory_footprint.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
@@ -18,7 +22,7 @@ class Context;
 /// total inventory size.  The inventory size and throughput capacity both
 /// default to infinite. If a recipe is provided, it will request material with
 /// that recipe. Requests are made for any number of specified commodities.
-class Sink : public cyclus::Facility  {
+class Sink : public cyclus::Facility, public ConcurrentTimeListener {
  public:
   Sink(cyclus::Context* ctx);
 
@@ -148,9 +152,57 @@ class Sink : public cyclus::Facility  {
                              "accept at each time step"}
   double capacity;
 
+  #pragma cyclus var {"default": False, \
+                      "userlevel": 10, \
+                      "tooltip": "absorb received resources", \
+                      "uilabel": "Absorb Inventory", \
+                      "doc": "If true, received materials are absorbed into " \
+                             "a single running material (and received " \
+                             "products into one product per quality) rather " \
+                             "than held as separate objects, keeping memory " \
+                             "and snapshot size bounded over long " \
+                             "simulations. Request amounts and transactions " \
+                             "are unaffected, but each absorption records " \
+                             "the running material's new state as a row in " \
+                             "the Resources table."}
+  bool absorb_inventory;
+
+  #pragma cyclus var {"default": False, \
+                      "userlevel": 10, \
+                      "tooltip": "record callback timings", \
+                      "uilabel": "Record Performance", \
+                      "doc": "If true, the wall time spent requesting and " \
+                             "accepting material is recorded to the " \
+                             "ArchetypePerf table every time step, with the " \
+                             "number of requests and trades handled."}
+  bool record_perf;
+
+  #pragma cyclus var {"default": 0, \
+                      "userlevel": 10, \
+                      "tooltip": "time steps between inventory footprints", \
+                      "uilabel": "Inventory Footprint Interval", \
+                      "doc": "If positive, the number of resource objects, " \
+                             "total quantity and number of distinct " \
+                             "compositions held in the inventory are " \
+                             "recorded to the InventoryFootprint table every " \
+                             "this many time steps."}
+  int footprint_interval;
+
+  /// records the inventory footprint if one is due this time step
+  void RecordFootprint_();
+
   /// this facility holds material in storage.
   #pragma cyclus var {'capacity': 'max_inv_size'}
   cyclus::toolkit::ResBuf<cyclus::Resource> inventory;
+
+  /// pushes received resources into the inventory, absorbing them into the
+  /// resources already held if absorb_inventory is set
+  void Store_(const std::vector<cyclus::Resource::Ptr>& rs);
+
+  ArchetypePerf perf_;
+
+  /// resolved recipe_name
+  RecipeHandle recipe_;
 };
 
 }  // namespace cycamore
@@ -264,6 +264,117 @@ TEST_F(SinkTest, BidPrefs) {
   EXPECT_EQ(0, qr2.rows.size());
   
 }
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, AbsorbInventory) {
+  using cyclus::QueryResult;
+
+  // absorbing received material must not change what the sink trades for
+  std::string config =
+    "   <in_commods>"
+    "     <val>commods_1</val>"
+    "     <val>commods_2</val>"
+    "   </in_commods>"
+    "   <capacity>2</capacity>"
+    "   <max_inv_size>5</max_inv_size>"
+    "   <absorb_inventory>1</absorb_inventory>"
+    "   <footprint_interval>1</footprint_interval>";
+
+  int simdur = 4;
+  cyclus::MockSim sim(cyclus::AgentSpec
+		      (":cycamore:Sink"), config, simdur);
+  sim.AddSource("commods_1")
+    .capacity(1)
+    .Finalize();
+  sim.AddSource("commods_2")
+    .capacity(1)
+    .Finalize();
+  int id = sim.Run();
+
+  cyclus::SqlStatement::Ptr stmt = sim.db().db().Prepare(
+      "SELECT SUM(r.Quantity) FROM Transactions AS t"
+      " INNER JOIN Resources AS r ON r.ResourceId = t.ResourceId;");
+  stmt->Step();
+  // 2 kg per time step until the 5 kg inventory is full
+  EXPECT_DOUBLE_EQ(5, stmt->GetDouble(0));
+
+  // while everything received is held as a single material
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("InventoryFootprint", &conds);
+  ASSERT_EQ(simdur, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); i++) {
+    EXPECT_EQ(1, qr.GetVal<int>("Count", i));
+    EXPECT_EQ(1, qr.GetVal<int>("Compositions", i));
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, RecordPerf) {
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+
+  std::string config =
+    "   <in_commods>"
+    "     <val>commods_1</val>"
+    "   </in_commods>"
+    "   <capacity>1</capacity>"
+    "   <record_perf>1</record_perf>";
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec
+		      (":cycamore:Sink"), config, simdur);
+  sim.AddSource("commods_1")
+    .capacity(1)
+    .Finalize();
+  int id = sim.Run();
+
+  // one Tick, GetMatlRequests, AcceptMatlTrades and Tock row per time step
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("ArchetypePerf", &conds);
+  EXPECT_EQ(4 * simdur, qr.rows.size());
+
+  conds.push_back(Cond("Phase", "==", std::string("AcceptMatlTrades")));
+  qr = sim.db().Query("ArchetypePerf", &conds);
+  ASSERT_EQ(simdur, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("Calls", 0));
+  EXPECT_EQ(1, qr.GetVal<int>("Count", 0));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, InventoryFootprint) {
+  using cyclus::Cond;
+  using cyclus::QueryResult;
+
+  std::string config =
+    "   <in_commods>"
+    "     <val>commods_1</val>"
+    "   </in_commods>"
+    "   <capacity>1</capacity>"
+    "   <footprint_interval>2</footprint_interval>";
+
+  int simdur = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec
+		      (":cycamore:Sink"), config, simdur);
+  sim.AddSource("commods_1")
+    .capacity(1)
+    .Finalize();
+  int id = sim.Run();
+
+  // one inventory row at times 0, 2 and 4, taken after that step's trade
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("InventoryFootprint", &conds);
+  EXPECT_EQ(3, qr.rows.size());
+
+  conds.push_back(Cond("Time", "==", 2));
+  qr = sim.db().Query("InventoryFootprint", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("inventory", qr.GetVal<std::string>("Buffer", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("Count", 0));
+  EXPECT_DOUBLE_EQ(3, qr.GetVal<double>("Quantity", 0));
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(SinkTest, Print) {
   EXPECT_NO_THROW(std::string s = src_facility->str());
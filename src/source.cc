@@ -2,6 +2,8 @@
 
 #include <sstream>
 #include <limits>
+#include <map>
+#include <utility>
 
 #include <boost/lexical_cast.hpp>
 
@@ -10,7 +12,9 @@ namespace cycamore {
 Source::Source(cyclus::Context* ctx)
     : cyclus::Facility(ctx),
       throughput(std::numeric_limits<double>::max()),
-      inventory_size(std::numeric_limits<double>::max()) {}
+      inventory_size(std::numeric_limits<double>::max()),
+      share_offers(false),
+      record_perf(false) {}
 
 Source::~Source() {}
 
@@ -26,6 +30,21 @@ void Source::InitFrom(cyclus::QueryableBackend* b) {
                              tk::CommodInfo(throughput, throughput));
 }
 
+void Source::EnterNotify() {
+  cyclus::Facility::EnterNotify();
+  if (!outrecipe.empty()) {
+    OutRecipe_();
+  }
+}
+
+cyclus::Composition::Ptr Source::OutRecipe_() {
+  return outrecipe_comp_.Get(context(), outrecipe);
+}
+
+void Source::Tock() {
+  PerfScope scope(&perf_, record_perf, PERF_TOCK, this);
+}
+
 std::string Source::str() {
   namespace tk = cyclus::toolkit;
   std::stringstream ss;
@@ -48,6 +67,7 @@ std::string Source::str() {
 
 std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
     cyclus::CommodMap<cyclus::Material>::type& commod_requests) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_BIDS, this);
   using cyclus::Bid;
   using cyclus::BidPortfolio;
   using cyclus::CapacityConstraint;
@@ -66,6 +86,14 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
     return ports;
   }
 
+  cyclus::Composition::Ptr recipe;
+  if (!outrecipe.empty()) {
+    recipe = OutRecipe_();
+  }
+
+  // offers shared between requests, keyed on (quantity, composition id)
+  std::map<std::pair<double, int>, Material::Ptr> offers;
+
   BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
   std::vector<Request<Material>*>& requests = commod_requests[outcommod];
   std::vector<Request<Material>*>::iterator it;
@@ -73,9 +101,20 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
     Request<Material>* req = *it;
     Material::Ptr target = req->target();
     double qty = std::min(target->quantity(), max_qty);
-    Material::Ptr m = Material::CreateUntracked(qty, target->comp());
-    if (!outrecipe.empty()) {
-      m = Material::CreateUntracked(qty, context()->GetRecipe(outrecipe));
+    cyclus::Composition::Ptr comp = recipe;
+    if (comp.get() == NULL) {
+      comp = target->comp();
+    }
+
+    Material::Ptr m;
+    if (share_offers) {
+      Material::Ptr& shared = offers[std::make_pair(qty, comp->id())];
+      if (shared.get() == NULL) {
+        shared = Material::CreateUntracked(qty, comp);
+      }
+      m = shared;
+    } else {
+      m = Material::CreateUntracked(qty, comp);
     }
     port->AddBid(req, m, this);
   }
@@ -83,6 +122,7 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
   CapacityConstraint<Material> cc(max_qty);
   port->AddConstraint(cc);
   ports.insert(port);
+  scope.Count(ArchetypePerf::NBids<Material>(ports));
   return ports;
 }
 
@@ -90,17 +130,24 @@ void Source::GetMatlTrades(
     const std::vector<cyclus::Trade<cyclus::Material> >& trades,
     std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                           cyclus::Material::Ptr> >& responses) {
+  PerfScope scope(&perf_, record_perf, PERF_GET_MATL_TRADES, this);
+  scope.Count(trades.size());
   using cyclus::Material;
   using cyclus::Trade;
 
+  cyclus::Composition::Ptr recipe;
+  if (!outrecipe.empty()) {
+    recipe = OutRecipe_();
+  }
+
   std::vector<cyclus::Trade<cyclus::Material> >::const_iterator it;
   for (it = trades.begin(); it != trades.end(); ++it) {
     double qty = it->amt;
     inventory_size -= qty;
 
     Material::Ptr response;
-    if (!outrecipe.empty()) {
-      response = Material::Create(this, qty, context()->GetRecipe(outrecipe));
+    if (recipe.get() != NULL) {
+      response = Material::Create(this, qty, recipe);
     } else {
       response = Material::Create(this, qty, it->request->target()->comp());
     }
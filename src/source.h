@@ -6,6 +6,9 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
@@ -21,7 +24,8 @@ class Context;
 /// inventory, and when the inventory size reaches zero, the source can provide
 /// no more material.
 class Source : public cyclus::Facility,
-  public cyclus::toolkit::CommodityProducer {
+  public cyclus::toolkit::CommodityProducer,
+  public ConcurrentTimeListener {
   friend class SourceTest;
  public:
 
@@ -56,9 +60,11 @@ class Source : public cyclus::Facility,
 
   virtual void InitFrom(cyclus::QueryableBackend* b);
 
+  virtual void EnterNotify();
+
   virtual void Tick() {};
 
-  virtual void Tock() {};
+  virtual void Tock();
 
   virtual std::string str();
 
@@ -115,6 +121,36 @@ class Source : public cyclus::Facility,
   }
   double throughput;
 
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "share offer materials between requests", \
+    "uilabel": "Share Offers", \
+    "doc": "If true, a single offer material is created and bid on every " \
+           "request of the same quantity and composition in a time step, " \
+           "instead of one offer material per request.", \
+  }
+  bool share_offers;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "record callback timings", \
+    "uilabel": "Record Performance", \
+    "doc": "If true, the wall time spent bidding and filling trades is " \
+           "recorded to the ArchetypePerf table every time step, with the " \
+           "number of bids and trades handled.", \
+  }
+  bool record_perf;
+
+  /// @return the outrecipe composition, resolved once (in EnterNotify or on
+  /// first use) rather than looked up in the context for every bid and trade
+  cyclus::Composition::Ptr OutRecipe_();
+
+  // resolved outrecipe
+  RecipeHandle outrecipe_comp_;
+
+  ArchetypePerf perf_;
 };
 
 }  // namespace cycamore
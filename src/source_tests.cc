@@ -80,6 +80,54 @@ TEST_F(SourceTest, AddBids) {
   EXPECT_EQ(*constrs.begin(), CapacityConstraint<Material>(capacity));
 }
 
+TEST_F(SourceTest, SharedOffers) {
+  using cyclus::Bid;
+  using cyclus::BidPortfolio;
+  using cyclus::Material;
+
+  int nreqs = 5;
+  share_offers(src_facility, true);
+
+  boost::shared_ptr< cyclus::ExchangeContext<Material> >
+      ec = GetContext(nreqs, commod);
+
+  std::set<BidPortfolio<Material>::Ptr> ports =
+      src_facility->GetMatlBids(ec.get()->commod_requests);
+  ASSERT_EQ(ports.size(), 1);
+
+  // every request has the same quantity and the recipe is fixed, so all
+  // bids offer the same material
+  const std::set<Bid<Material>*>& bids = (*ports.begin())->bids();
+  ASSERT_EQ(bids.size(), nreqs);
+  Material::Ptr offer = (*bids.begin())->offer();
+  std::set<Bid<Material>*>::const_iterator it;
+  for (it = bids.begin(); it != bids.end(); ++it) {
+    EXPECT_EQ(offer, (*it)->offer());
+  }
+  EXPECT_EQ(offer->comp(), recipe);
+}
+
+TEST_F(SourceTest, RecipeHandle) {
+  using cyclus::Composition;
+
+  Composition::Ptr other = Composition::CreateFromAtom(cyclus::CompMap());
+  tc.get()->AddRecipe("other", other);
+
+  // a handle resolves its recipe once and again only when the name changes
+  RecipeHandle h;
+  EXPECT_EQ(recipe, h.Get(tc.get(), recipe_name));
+  EXPECT_EQ(recipe, h.Get(tc.get(), recipe_name));
+  EXPECT_EQ(other, h.Get(tc.get(), "other"));
+
+  std::vector<std::string> names;
+  names.push_back(recipe_name);
+  names.push_back("other");
+  RecipeHandles hs;
+  EXPECT_EQ(other, hs.Get(tc.get(), names, 1));
+  EXPECT_EQ(recipe, hs.Get(tc.get(), names, 0));
+  EXPECT_THROW(hs.Get(tc.get(), names, 2), cyclus::KeyError);
+}
+
 TEST_F(SourceTest, Response) {
   using cyclus::Bid;
   using cyclus::Material;
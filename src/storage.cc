@@ -5,7 +5,12 @@
 namespace storage {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Storage::Storage(cyclus::Context* ctx) : cyclus::Facility(ctx) {
+Storage::Storage(cyclus::Context* ctx)
+    : cyclus::Facility(ctx),
+      aggregate_batches(false),
+      record_perf(false),
+      footprint_interval(0),
+      wheel_loaded_(false) {
   cyclus::Warn<cyclus::EXPERIMENTAL_WARNING>(
       "The Storage Facility is experimental.");
 };
@@ -23,8 +28,6 @@ Storage::Storage(cyclus::Context* ctx) : cyclus::Facility(ctx) {
 
 #pragma cyclus def infiletodb storage::Storage
 
-#pragma cyclus def snapshot storage::Storage
-
 #pragma cyclus def clone storage::Storage
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -43,6 +46,12 @@ void Storage::InitFrom(cyclus::QueryableBackend* b) {
   cyclus::toolkit::CommodityProducer::SetCapacity(commod, throughput);
 }
 
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::Snapshot(cyclus::DbInit di) {
+  SyncEntryTimes_();
+#pragma cyclus impl snapshot storage::Storage
+}
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::EnterNotify() {
   cyclus::Facility::EnterNotify();
@@ -110,6 +119,8 @@ std::string Storage::str() {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::Tick() {
+  cycamore::PerfScope scope(&perf_, record_perf, cycamore::PERF_TICK, this);
+
   // Set available capacity for Buy Policy
   inventory.capacity(current_capacity());
 
@@ -124,6 +135,15 @@ void Storage::Tick() {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::Tock() {
+  cycamore::PerfScope scope(&perf_, record_perf, cycamore::PERF_TOCK, this);
+  scope.Count(inventory.count());
+  RecordFootprint_();
+
+  int next = NextEventTime();
+  if (next == -1 || next > context()->time()) {
+    return;  // nothing received, ready or due this time step
+  }
+
   LOG(cyclus::LEV_INFO3, "ComCnv") << prototype() << " is tocking {";
 
   BeginProcessing_();  // place unprocessed inventory into processing
@@ -137,6 +157,22 @@ void Storage::Tock() {
   LOG(cyclus::LEV_INFO3, "ComCnv") << "}";
 }
 
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int Storage::NextEventTime() {
+  int t = context()->time();
+  if (!inventory.empty() || !ready.empty()) {
+    return t;
+  }
+
+  LoadWheel_();
+  if (entry_wheel_.empty()) {
+    return -1;
+  }
+  // residence_time is read here rather than cached since it may change while
+  // material is being processed
+  return std::max(t, entry_wheel_.front().first + residence_time);
+}
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::AddMat_(cyclus::Material::Ptr mat) {
   LOG(cyclus::LEV_INFO5, "ComCnv") << prototype() << " is initially holding "
@@ -157,19 +193,34 @@ void Storage::AddMat_(cyclus::Material::Ptr mat) {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::BeginProcessing_() {
-  while (inventory.count() > 0) {
-    try {
-      processing.Push(inventory.Pop());
-      entry_times.push_back(context()->time());
+  LoadWheel_();
+  if (inventory.count() == 0) {
+    return;
+  }
 
-      LOG(cyclus::LEV_DEBUG2, "ComCnv")
-          << "Storage " << prototype()
-          << " added resources to processing at t= " << context()->time();
-    } catch (cyclus::Error& e) {
-      e.msg(Agent::InformErrorMsg(e.msg()));
-      throw e;
+  int n = inventory.count();
+  try {
+    if (aggregate_batches && !discrete_handling) {
+      processing.Push(cyclus::toolkit::Squash(inventory.PopN(n)));
+      n = 1;
+    } else {
+      processing.Push(inventory.PopN(n));
     }
+  } catch (cyclus::Error& e) {
+    e.msg(Agent::InformErrorMsg(e.msg()));
+    throw e;
   }
+
+  int t = context()->time();
+  if (!entry_wheel_.empty() && entry_wheel_.back().first == t) {
+    entry_wheel_.back().second += n;
+  } else {
+    entry_wheel_.push_back(std::make_pair(t, n));
+  }
+
+  LOG(cyclus::LEV_DEBUG2, "ComCnv") << "Storage " << prototype() << " added "
+                                    << n << " batch(es) to processing at t= "
+                                    << t;
 }
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -210,16 +261,63 @@ void Storage::ProcessMat_(double cap) {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::ReadyMatl_(int time) {
-  using cyclus::toolkit::ResBuf;
+  LoadWheel_();
 
   int to_ready = 0;
+  while (!entry_wheel_.empty() && entry_wheel_.front().first <= time) {
+    to_ready += entry_wheel_.front().second;
+    entry_wheel_.pop_front();
+  }
+
+  if (to_ready > 0) {
+    ready.Push(processing.PopN(to_ready));
+  }
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::LoadWheel_() {
+  if (wheel_loaded_) {
+    return;
+  }
+
+  entry_wheel_.clear();
+  std::list<int>::iterator it;
+  for (it = entry_times.begin(); it != entry_times.end(); ++it) {
+    if (!entry_wheel_.empty() && entry_wheel_.back().first == *it) {
+      entry_wheel_.back().second++;
+    } else {
+      entry_wheel_.push_back(std::make_pair(*it, 1));
+    }
+  }
+  entry_times.clear();
+  wheel_loaded_ = true;
+}
 
-  while (!entry_times.empty() && entry_times.front() <= time) {
-    entry_times.pop_front();
-    ++to_ready;
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::SyncEntryTimes_() {
+  if (!wheel_loaded_) {
+    return;  // entry_times is still authoritative
   }
 
-  ready.Push(processing.PopN(to_ready));
+  entry_times.clear();
+  std::deque<std::pair<int, int> >::iterator it;
+  for (it = entry_wheel_.begin(); it != entry_wheel_.end(); ++it) {
+    entry_times.insert(entry_times.end(), it->second, it->first);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::RecordFootprint_() {
+  if (!cycamore::InventoryFootprint::Due(footprint_interval,
+                                         context()->time())) {
+    return;
+  }
+  cycamore::InventoryFootprint fp;
+  fp.AddBuf("inventory", &inventory);
+  fp.AddBuf("processing", &processing);
+  fp.AddBuf("ready", &ready);
+  fp.AddBuf("stocks", &stocks);
+  fp.Record(this);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
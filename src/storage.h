@@ -1,11 +1,17 @@
 #ifndef CYCLUS_STORAGES_STORAGE_H_
 #define CYCLUS_STORAGES_STORAGE_H_
 
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <list>
+#include <utility>
 #include <vector>
 
 #include "cyclus.h"
+#include "archetype_perf.h"
+#include "datum_stage.h"
+#include "inventory_footprint.h"
 
 // forward declaration
 namespace storage {
@@ -65,7 +71,8 @@ namespace storage {
 /// Matched resources are sent immediately.
 class Storage 
   : public cyclus::Facility,
-    public cyclus::toolkit::CommodityProducer {
+    public cyclus::toolkit::CommodityProducer,
+    public cycamore::ConcurrentTimeListener {
  public:  
   /// @param ctx the cyclus context for access to simulation-wide parameters
   Storage(cyclus::Context* ctx);
@@ -98,6 +105,12 @@ class Storage
   /// The handleTick function specific to the Storage.
   virtual void Tock();
 
+  /// @brief returns the earliest time step, at or after the current one, at
+  /// which Tock will move material between buffers if no more material is
+  /// received, or -1 if no material is waiting on its residence time.  Tock
+  /// does nothing until then.
+  int NextEventTime();
+
  protected:
   ///   @brief adds a material into the incoming commodity inventory
   ///   @param mat the material to add to the incoming inventory.
@@ -115,6 +128,13 @@ class Storage
   /// @param time the time of interest
   void ReadyMatl_(int time);
 
+  /// @brief builds the residence wheel from entry_times the first time it is
+  /// needed (entry_times is only authoritative until then)
+  void LoadWheel_();
+
+  /// @brief rewrites entry_times from the residence wheel
+  void SyncEntryTimes_();
+
     /* --- Storage Members --- */
 
   /// @brief current maximum amount that can be added to processing
@@ -188,7 +208,39 @@ class Storage
                             "If true, batches are handled as discrete quanta, neither split nor combined. "\
                             "Otherwise, batches may be divided during processing. Default to false (continuous))",\
                       "uilabel":"Batch Handling"}
-  bool discrete_handling;                    
+  bool discrete_handling;
+
+  #pragma cyclus var {"default": False,\
+                      "tooltip":"Bool to squash each time step's receipts into one batch",\
+                      "doc":"Only used when discrete_handling is false. If true, all material "\
+                            "entering processing in the same time step is combined into a single "\
+                            "batch, so the number of held material objects scales with the "\
+                            "residence time rather than with the number of receipts. Batches "\
+                            "received together are blended into one composition.",\
+                      "uilabel":"Aggregate Batches"}
+  bool aggregate_batches;                    
+
+  #pragma cyclus var {"default": False,\
+                      "userlevel": 10,\
+                      "tooltip":"Bool to record callback timings",\
+                      "doc":"If true, the wall time spent in Tick and Tock is recorded to "\
+                            "the ArchetypePerf table every time step, with the number of "\
+                            "material objects moved into processing.",\
+                      "uilabel":"Record Performance"}
+  bool record_perf;
+
+  #pragma cyclus var {"default": 0,\
+                      "userlevel": 10,\
+                      "tooltip":"Time steps between inventory footprints",\
+                      "doc":"If positive, the number of material objects, total quantity and "\
+                            "number of distinct compositions held in each buffer are "\
+                            "recorded to the InventoryFootprint table every this many "\
+                            "time steps.",\
+                      "uilabel":"Inventory Footprint Interval"}
+  int footprint_interval;
+
+  /// records the inventory footprint if one is due this time step
+  void RecordFootprint_();
 
   #pragma cyclus var {"tooltip":"Incoming material buffer"}
   cyclus::toolkit::ResBuf<cyclus::Material> inventory;
@@ -207,6 +259,15 @@ class Storage
   #pragma cyclus var {"tooltip":"Buffer for material still waiting for required residence_time"}
   cyclus::toolkit::ResBuf<cyclus::Material> processing;
 
+  // residence wheel: one (entry time, number of materials) bucket per time
+  // step in which materials entered processing, oldest first.  Buckets are
+  // keyed on entry time, not due time, so residence_time may change while
+  // material is being processed.
+  std::deque<std::pair<int, int> > entry_wheel_;
+  bool wheel_loaded_;
+
+  cycamore::ArchetypePerf perf_;
+
   //// A policy for requesting material
   cyclus::toolkit::MatlBuyPolicy buy_policy;
 
@@ -23,6 +23,7 @@ void StorageTest::InitParameters(){
   max_inv_size = 200;
   throughput = 20;
   discrete_handling = 0;
+  aggregate_batches = 0;
 
   cyclus::CompMap v;
   v[922350000] = 1;
@@ -39,6 +40,7 @@ void StorageTest::SetUpStorage(){
   src_facility_->max_inv_size = max_inv_size;
   src_facility_->throughput = throughput;
   src_facility_->discrete_handling = discrete_handling;
+  src_facility_->aggregate_batches = aggregate_batches;
 }
 
 void StorageTest::TestInitState(Storage* fac){
@@ -86,6 +88,12 @@ void StorageTest::TestReadyTime(Storage* fac, int t){
   EXPECT_EQ(t, fac->ready_time());
 }
 
+void StorageTest::TestEntryTimes(Storage* fac, std::list<int> times){
+
+  fac->SyncEntryTimes_();
+  EXPECT_EQ(times, fac->entry_times);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(StorageTest, clone) {
   Storage* cloned_fac =
@@ -321,6 +329,71 @@ TEST_F(StorageTest, TwoBatchSameTime) {
   TestBuffers(src_facility_,0,0,0,0.4*cap);
 }
 
+TEST_F(StorageTest, EntryTimes) {
+  // the residence wheel must reproduce one entry time per processing material
+  cyclus::Composition::Ptr rec = tc_.get()->GetRecipe(in_r1);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(1, rec));
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(2, rec));
+  EXPECT_NO_THROW(src_facility_->Tock());
+
+  tc_.get()->time(2);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(3, rec));
+  EXPECT_NO_THROW(src_facility_->Tock());
+
+  std::list<int> times;
+  times.push_back(0);
+  times.push_back(0);
+  times.push_back(2);
+  TestEntryTimes(src_facility_, times);
+
+  tc_.get()->time(residence_time);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBuffers(src_facility_,0,3,0,3);
+  times.clear();
+  times.push_back(2);
+  TestEntryTimes(src_facility_, times);
+}
+
+TEST_F(StorageTest, NextEventTime) {
+  // nothing to do until the oldest processing material is due
+  EXPECT_EQ(-1, src_facility_->NextEventTime());
+
+  cyclus::Composition::Ptr rec = tc_.get()->GetRecipe(in_r1);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(1, rec));
+  EXPECT_EQ(0, src_facility_->NextEventTime());
+  EXPECT_NO_THROW(src_facility_->Tock());
+  EXPECT_EQ(residence_time, src_facility_->NextEventTime());
+
+  tc_.get()->time(residence_time - 1);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBuffers(src_facility_,0,1,0,0);
+
+  tc_.get()->time(residence_time);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBuffers(src_facility_,0,0,0,1);
+  EXPECT_EQ(-1, src_facility_->NextEventTime());
+}
+
+TEST_F(StorageTest, AggregateBatches) {
+  // receipts entering processing together become a single batch
+  aggregate_batches = 1;
+  SetUpStorage();
+
+  cyclus::Composition::Ptr rec = tc_.get()->GetRecipe(in_r1);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(1, rec));
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(2, rec));
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBuffers(src_facility_,0,3,0,0);
+
+  std::list<int> times;
+  times.push_back(0);
+  TestEntryTimes(src_facility_, times);
+
+  tc_.get()->time(residence_time);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBuffers(src_facility_,0,0,0,3);
+}
+
 TEST_F(StorageTest,ChangeProcessTime){
   // Initialize process time variable and add first batch
   int proc_time1 = residence_time;
@@ -28,13 +28,14 @@ class StorageTest : public ::testing::Test {
   void TestStocks(storage::Storage* fac, cyclus::CompMap v);
   void TestReadyTime(storage::Storage* fac, int t);
   void TestCurrentCap(storage::Storage* fac, double inv);
+  void TestEntryTimes(storage::Storage* fac, std::list<int> times);
 
   std::vector<std::string> in_c1, out_c1;
   std::string in_r1;
 
   int residence_time;
   double throughput, max_inv_size;
-  bool discrete_handling;
+  bool discrete_handling, aggregate_batches;
 };
 } // namespace storage
 #endif // STORAGE_TESTS_H_
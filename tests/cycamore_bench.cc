@@ -0,0 +1,464 @@
+// Microbenchmarks for the cycamore archetypes' exchange and time step
+// callbacks.
+//
+// The BM_*<Scenario> benchmarks drive one archetype through a short
+// cyclus::MockSim and time the simulation run, so that GetMatlRequests,
+// GetMatlBids, GetMatlTrades, AcceptMatlTrades, Tick and Tock are all
+// exercised against a parameterized inventory size or number of trading
+// partners. Construction of the mock simulation is excluded from the timings.
+//
+// The BM_<Archetype><Callback> benchmarks build the archetype directly in a
+// cyclus::TestContext with its inventory already in place and time a single
+// callback, so that a change to one callback shows up on its own.
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "cyclus.h"
+#include "env.h"
+#include "logger.h"
+#include "test_context.h"
+
+#include "fuel_fab.h"
+#include "mixer.h"
+#include "reactor.h"
+#include "separations.h"
+
+using pyne::nucname::id;
+using cyclus::Composition;
+
+namespace {
+
+const int kSimDur = 10;
+
+Composition::Ptr c_natu() {
+  cyclus::CompMap m;
+  m[id("u235")] = 0.007;
+  m[id("u238")] = 0.993;
+  return Composition::CreateFromMass(m);
+}
+
+Composition::Ptr c_uox() {
+  cyclus::CompMap m;
+  m[id("u235")] = 0.04;
+  m[id("u238")] = 0.96;
+  return Composition::CreateFromMass(m);
+}
+
+Composition::Ptr c_spentuox() {
+  cyclus::CompMap m;
+  m[id("u235")] = .8;
+  m[id("u238")] = 100;
+  m[id("pu239")] = 1;
+  return Composition::CreateFromMass(m);
+}
+
+Composition::Ptr c_pustream() {
+  cyclus::CompMap m;
+  m[id("pu239")] = 100;
+  m[id("pu240")] = 10;
+  m[id("pu241")] = 1;
+  m[id("pu242")] = 1;
+  return Composition::CreateFromMass(m);
+}
+
+// A reactor discharging range(0) assemblies every cycle into a spent fuel
+// buffer that is only drained one assembly per time step, so that its bids
+// and trades run over a growing spent inventory.
+void BM_ReactorSpentInventory(benchmark::State& state) {
+  int n = state.range(0);
+  std::stringstream config;
+  config << "<fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>"
+         << "<fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>"
+         << "<fuel_incommods>  <val>uox</val>      </fuel_incommods>"
+         << "<fuel_outcommods> <val>waste</val>    </fuel_outcommods>"
+         << "<cycle_time>1</cycle_time>"
+         << "<refuel_time>0</refuel_time>"
+         << "<assem_size>1</assem_size>"
+         << "<n_assem_core>" << n << "</n_assem_core>"
+         << "<n_assem_batch>" << n << "</n_assem_batch>";
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config.str(),
+                        kSimDur);
+    sim.AddSource("uox").Finalize();
+    sim.AddSink("waste").capacity(1).Finalize();
+    sim.AddRecipe("uox", c_uox());
+    sim.AddRecipe("spentuox", c_spentuox());
+    state.ResumeTiming();
+    sim.Run();
+  }
+}
+BENCHMARK(BM_ReactorSpentInventory)
+    ->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+// An enrichment plant answering range(0) product requests every time step.
+void BM_EnrichmentRequests(benchmark::State& state) {
+  int n = state.range(0);
+  std::string config =
+      "<feed_commod>natu</feed_commod>"
+      "<feed_recipe>natu</feed_recipe>"
+      "<product_commod>enr_u</product_commod>"
+      "<tails_commod>tails</tails_commod>"
+      "<tails_assay>0.003</tails_assay>"
+      "<initial_feed>1e6</initial_feed>";
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Enrichment"), config,
+                        kSimDur);
+    sim.AddRecipe("natu", c_natu());
+    sim.AddRecipe("leu", c_uox());
+    sim.AddSource("natu").recipe("natu").Finalize();
+    for (int i = 0; i < n; i++) {
+      sim.AddSink("enr_u").recipe("leu").capacity(1).Finalize();
+    }
+    state.ResumeTiming();
+    sim.Run();
+  }
+}
+BENCHMARK(BM_EnrichmentRequests)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMillisecond);
+
+// A source answering range(0) requests every time step.
+void BM_SourceRequests(benchmark::State& state) {
+  int n = state.range(0);
+  std::string config =
+      "<outcommod>uox</outcommod>"
+      "<outrecipe>uox</outrecipe>";
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Source"), config,
+                        kSimDur);
+    sim.AddRecipe("uox", c_uox());
+    for (int i = 0; i < n; i++) {
+      sim.AddSink("uox").capacity(1).Finalize();
+    }
+    state.ResumeTiming();
+    sim.Run();
+  }
+}
+BENCHMARK(BM_SourceRequests)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMillisecond);
+
+// A sink receiving offers from range(0) suppliers every time step, so that
+// its inventory grows by range(0) resources per step.
+void BM_SinkOffers(benchmark::State& state) {
+  int n = state.range(0);
+  std::string config =
+      "<in_commods> <val>waste</val> </in_commods>";
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, kSimDur);
+    for (int i = 0; i < n; i++) {
+      sim.AddSource("waste").capacity(1).Finalize();
+    }
+    state.ResumeTiming();
+    sim.Run();
+  }
+}
+BENCHMARK(BM_SinkOffers)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMillisecond);
+
+// A storage facility fed by range(0) suppliers, holding each batch for one
+// time step before offering it on.
+void BM_StorageBatches(benchmark::State& state) {
+  int n = state.range(0);
+  std::string config =
+      "<in_commods>  <val>spent_fuel</val> </in_commods>"
+      "<out_commods> <val>dry_spent</val>  </out_commods>"
+      "<residence_time>1</residence_time>";
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Storage"), config,
+                        kSimDur);
+    for (int i = 0; i < n; i++) {
+      sim.AddSource("spent_fuel").capacity(1).Finalize();
+    }
+    sim.AddSink("dry_spent").Finalize();
+    state.ResumeTiming();
+    sim.Run();
+  }
+}
+BENCHMARK(BM_StorageBatches)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+namespace cycamore {
+
+// Builds archetypes with their state set in place, for timing single
+// callbacks.  The archetypes declare it a friend, as they do their unit test
+// fixtures.
+class CallbackBench {
+ public:
+  // a reactor holding n spent assemblies
+  static Reactor* SpentReactor(cyclus::Context* ctx, int n) {
+    Reactor* r = new Reactor(ctx);
+    r->fuel_incommods.push_back("uox");
+    r->fuel_inrecipes.push_back("uox");
+    r->fuel_outcommods.push_back("waste");
+    r->fuel_outrecipes.push_back("spentuox");
+    r->assem_size = 1;
+
+    cyclus::Inventories inv;
+    for (int i = 0; i < n; i++) {
+      cyclus::Material::Ptr m =
+          cyclus::Material::CreateUntracked(1, c_spentuox());
+      r->res_indexes[m->obj_id()] = 0;
+      inv["spent"].push_back(m);
+    }
+    r->InitInv(inv);
+    return r;
+  }
+
+  // a fuel fab holding n fill and n fissile materials; the context must
+  // have the natu recipe
+  static FuelFab* StockedFuelFab(cyclus::Context* ctx, int n) {
+    FuelFab* f = new FuelFab(ctx);
+    f->fill_commods.push_back("natu");
+    f->fill_recipe = "natu";
+    f->fill_size = n;
+    f->fiss_commods.push_back("pustream");
+    f->fiss_size = n;
+    f->outcommod = "mox";
+    f->spectrum = "thermal";
+    f->throughput = 2 * n;
+    f->EnterNotify();
+
+    for (int i = 0; i < n; i++) {
+      f->PushMix(&f->fill, &f->fill_mix_,
+                 cyclus::Material::CreateUntracked(1, c_natu()));
+      f->PushMix(&f->fiss, &f->fiss_mix_,
+                 cyclus::Material::CreateUntracked(1, c_pustream()));
+    }
+    return f;
+  }
+
+  // a separations facility with n feed materials, separating uranium and
+  // plutonium streams
+  static Separations* FedSeparations(cyclus::Context* ctx, int n) {
+    Separations* s = new Separations(ctx);
+    std::map<int, double> u;
+    u[id("U")] = 0.99;
+    std::map<int, double> pu;
+    pu[id("Pu")] = 0.99;
+    s->streams_["uranium"] = std::make_pair(-1.0, u);
+    s->streams_["plutonium"] = std::make_pair(-1.0, pu);
+    s->leftover_commod = "waste";
+    s->throughput = n;
+
+    cyclus::Inventories inv;
+    for (int i = 0; i < n; i++) {
+      inv["feed-inv-name"].push_back(
+          cyclus::Material::CreateUntracked(1, c_spentuox()));
+    }
+    s->InitInv(inv);
+    return s;
+  }
+
+  // the buffer of one of a separations facility's streams
+  static cyclus::toolkit::ResBuf<cyclus::Material>* StreamBuf(
+      Separations* s, const std::string& name) {
+    return &s->streambufs[name];
+  }
+
+  // a mixer of three equal streams, each holding n materials
+  static Mixer* StockedMixer(cyclus::Context* ctx, int n) {
+    Composition::Ptr comps[] = {c_natu(), c_uox(), c_pustream()};
+    Mixer* m = new Mixer(ctx);
+    cyclus::Inventories inv;
+    for (int i = 0; i < 3; i++) {
+      std::string stream = std::to_string(i);
+      std::map<std::string, double> commods;
+      commods["stream" + stream] = 1;
+      m->streams_.push_back(
+          std::make_pair(std::pair<double, double>(1.0 / 3, n), commods));
+      m->mixing_ratios.push_back(1.0 / 3);
+      for (int j = 0; j < n; j++) {
+        inv["in_stream_" + stream].push_back(
+            cyclus::Material::CreateUntracked(1, comps[i]));
+      }
+    }
+    m->out_commod = "mixed";
+    m->throughput = n;
+    m->InitInv(inv);
+    return m;
+  }
+};
+
+}  // namespace cycamore
+
+namespace {
+
+using cycamore::CallbackBench;
+
+typedef cyclus::CommodMap<cyclus::Material>::type CommodRequests;
+
+// n requests for qty of comp on commod, made by the context's test trader
+CommodRequests Requests(cyclus::TestContext* tc, const std::string& commod,
+                        int n, Composition::Ptr comp, double qty) {
+  CommodRequests reqs;
+  for (int i = 0; i < n; i++) {
+    reqs[commod].push_back(cyclus::Request<cyclus::Material>::Create(
+        cyclus::Material::CreateUntracked(qty, comp), tc->trader(), commod));
+  }
+  return reqs;
+}
+
+void DeleteRequests(CommodRequests* reqs) {
+  CommodRequests::iterator it;
+  for (it = reqs->begin(); it != reqs->end(); ++it) {
+    for (int i = 0; i < it->second.size(); i++) {
+      delete it->second[i];
+    }
+  }
+  reqs->clear();
+}
+
+// Reactor::GetMatlBids over range(0) spent assemblies, all wanted by one
+// request.
+void BM_ReactorGetMatlBids(benchmark::State& state) {
+  int n = state.range(0);
+  cyclus::TestContext tc;
+  cycamore::Reactor* r = CallbackBench::SpentReactor(tc.get(), n);
+  CommodRequests reqs = Requests(&tc, "waste", 1, c_spentuox(), n);
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(r->GetMatlBids(reqs));
+  }
+  DeleteRequests(&reqs);
+  delete r;
+}
+BENCHMARK(BM_ReactorGetMatlBids)
+    ->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+// FuelFab::GetMatlBids from 100 fill and fissile materials to range(0)
+// requests for mixed fuel.
+void BM_FuelFabGetMatlBids(benchmark::State& state) {
+  int n = state.range(0);
+  cyclus::TestContext tc;
+  tc.get()->AddRecipe("natu", c_natu());
+  cycamore::FuelFab* f = CallbackBench::StockedFuelFab(tc.get(), 100);
+  CommodRequests reqs = Requests(&tc, "mox", n, c_uox(), 1);
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(f->GetMatlBids(reqs));
+  }
+  DeleteRequests(&reqs);
+  delete f;
+}
+BENCHMARK(BM_FuelFabGetMatlBids)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMicrosecond);
+
+// FuelFab::GetMatlTrades filling one request from range(0) fill and fissile
+// materials.
+void BM_FuelFabGetMatlTrades(benchmark::State& state) {
+  using cyclus::Material;
+  int n = state.range(0);
+  cyclus::TestContext tc;
+  tc.get()->AddRecipe("natu", c_natu());
+  CommodRequests reqs = Requests(&tc, "mox", 1, c_uox(), 1);
+  cyclus::Request<Material>* req = reqs["mox"][0];
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cycamore::FuelFab* f = CallbackBench::StockedFuelFab(tc.get(), n);
+    cyclus::Bid<Material>* bid =
+        cyclus::Bid<Material>::Create(req, req->target(), f);
+    std::vector<cyclus::Trade<Material> > trades;
+    trades.push_back(cyclus::Trade<Material>(req, bid, 1));
+    std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> > responses;
+    state.ResumeTiming();
+
+    f->GetMatlTrades(trades, responses);
+
+    state.PauseTiming();
+    delete bid;
+    delete f;
+    state.ResumeTiming();
+  }
+  DeleteRequests(&reqs);
+}
+BENCHMARK(BM_FuelFabGetMatlTrades)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMicrosecond);
+
+// Separations::Tick separating a throughput's worth of range(0) feed
+// materials.
+void BM_SeparationsTick(benchmark::State& state) {
+  int n = state.range(0);
+  cyclus::TestContext tc;
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cycamore::Separations* s = CallbackBench::FedSeparations(tc.get(), n);
+    state.ResumeTiming();
+
+    s->Tick();
+
+    state.PauseTiming();
+    delete s;
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_SeparationsTick)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMicrosecond);
+
+// Separations::GetMatlBids over a stream buffer of range(0) materials of
+// alternating compositions, all wanted by one request.
+void BM_SeparationsGetMatlBids(benchmark::State& state) {
+  int n = state.range(0);
+  cyclus::TestContext tc;
+  cycamore::Separations* s = CallbackBench::FedSeparations(tc.get(), 0);
+  Composition::Ptr comps[] = {c_natu(), c_uox()};
+  for (int i = 0; i < n; i++) {
+    CallbackBench::StreamBuf(s, "uranium")->Push(
+        cyclus::Material::CreateUntracked(1, comps[i % 2]));
+  }
+  CommodRequests reqs = Requests(&tc, "uranium", 1, c_natu(), n);
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(s->GetMatlBids(reqs));
+  }
+  DeleteRequests(&reqs);
+  delete s;
+}
+BENCHMARK(BM_SeparationsGetMatlBids)
+    ->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMicrosecond);
+
+// Mixer::Tick mixing three streams of range(0) materials each.
+void BM_MixerTick(benchmark::State& state) {
+  int n = state.range(0);
+  cyclus::TestContext tc;
+
+  while (state.KeepRunning()) {
+    state.PauseTiming();
+    cycamore::Mixer* m = CallbackBench::StockedMixer(tc.get(), n);
+    state.ResumeTiming();
+
+    m->Tick();
+
+    state.PauseTiming();
+    delete m;
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_MixerTick)
+    ->RangeMultiplier(10)->Range(1, 1000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // tell ENV the path between the cwd and the cyclus executable
+  std::string path = cyclus::Env::PathBase(argv[0]);
+  cyclus::Logger::ReportLevel() = cyclus::LEV_ERROR;
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,104 @@
+#!/usr/bin/env python
+"""Reconstructs per-time-step reactor power from power segments.
+
+Reactors with ``power_segments`` enabled record their power to the
+``ReactorPowerSegments`` table as one (AgentId, StartTime, EndTime, Value) row
+per run of time steps with the same power instead of one ``TimeSeriesPower``
+row per time step.  EndTime is the last time step of the run.
+
+To add a ``ReactorPowerDense`` view with (AgentId, Time, Value) rows to a
+SQLite output database:
+
+.. code-block:: bash
+
+  $ python power_segments.py view cyclus.sqlite
+
+To copy the reconstructed rows into the ``TimeSeriesPower`` table instead, so
+that existing post-processing works unchanged:
+
+.. code-block:: bash
+
+  $ python power_segments.py expand cyclus.sqlite
+"""
+from __future__ import print_function
+
+import argparse
+import sqlite3
+import sys
+
+VIEW = "ReactorPowerDense"
+
+DENSE_SQL = """
+WITH RECURSIVE steps(AgentId, Time, EndTime, Value) AS (
+    SELECT AgentId, StartTime, EndTime, Value FROM ReactorPowerSegments
+    UNION ALL
+    SELECT AgentId, Time + 1, EndTime, Value FROM steps WHERE Time < EndTime
+)
+SELECT AgentId, Time, Value FROM steps
+"""
+
+
+def dense(conn):
+    """Returns a dict mapping each agent id to a list of (time, value) pairs,
+    one per time step covered by the agent's power segments, in time order.
+    """
+    series = {}
+    for agent, t, value in conn.execute(DENSE_SQL + " ORDER BY AgentId, Time"):
+        series.setdefault(agent, []).append((t, value))
+    return series
+
+
+def view(args):
+    """Creates the dense power view in a database."""
+    conn = sqlite3.connect(args.db)
+    with conn:
+        conn.execute("DROP VIEW IF EXISTS " + VIEW)
+        conn.execute("CREATE VIEW " + VIEW + " AS " + DENSE_SQL)
+    conn.close()
+
+
+def expand(args):
+    """Appends the dense power rows to the TimeSeriesPower table."""
+    conn = sqlite3.connect(args.db)
+    cols = [r[1] for r in conn.execute("PRAGMA table_info(TimeSeriesPower)")]
+    if not cols:
+        conn.execute("CREATE TABLE TimeSeriesPower "
+                     "(SimId BLOB, AgentId INTEGER, Time INTEGER, Value REAL)")
+        cols = ["SimId", "AgentId", "Time", "Value"]
+    sim_id = conn.execute("SELECT SimId FROM Info").fetchone()[0]
+
+    rows = []
+    for agent, pts in dense(conn).items():
+        for t, value in pts:
+            row = {"SimId": sim_id, "AgentId": agent, "Time": t,
+                   "Value": value, "Units": ""}
+            rows.append(tuple(row.get(c) for c in cols))
+    with conn:
+        conn.executemany("INSERT INTO TimeSeriesPower (" + ", ".join(cols) +
+                         ") VALUES (" + ", ".join("?" * len(cols)) + ")",
+                         rows)
+    conn.close()
+    print("added {0} TimeSeriesPower rows".format(len(rows)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("view", help="add a dense power view")
+    p.add_argument("db", help="SQLite output database")
+    p.set_defaults(func=view)
+
+    p = sub.add_parser("expand", help="write dense rows to TimeSeriesPower")
+    p.add_argument("db", help="SQLite output database")
+    p.set_defaults(func=expand)
+
+    args = parser.parse_args()
+    if getattr(args, "func", None) is None:
+        parser.print_help()
+        sys.exit(1)
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
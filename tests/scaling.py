@@ -0,0 +1,254 @@
+#!/usr/bin/env python
+"""Scaling scenarios for cycamore.
+
+This module expands the small example inputs into scenarios with many
+facilities and times cyclus on them, so that the cost of a change can be
+compared across commits as the number of facilities grows.
+
+To generate scaled copies of an input, with every Reactor, Enrichment,
+FuelFab and Separations deployed N times, whether from an initial facility
+list or a DeployInst, and every GrowthRegion demand multiplied by N so that
+N times as many facilities are built to meet it:
+
+.. code-block:: bash
+
+  $ python scaling.py gen ../input/recycle.xml -n 10 100 1000 -o scaling
+
+To run cyclus on the generated inputs and record wall time per time step,
+peak resident memory and output database size as JSON:
+
+.. code-block:: bash
+
+  $ python scaling.py run scaling/*.xml -o timings.json
+"""
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import re
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+import xml.etree.ElementTree as ET
+
+# archetypes whose deployments are scaled by the generator
+SCALED_ARCHETYPES = ("Reactor", "Enrichment", "FuelFab", "Separations")
+
+# cyclus's timer logs the start of each time step at this level
+STEP_LOG_LEVEL = "LEV_INFO2"
+TIME_RE = re.compile(r"Current time:\s*(\d+)")
+
+
+def archetype_of(facility):
+    """Returns the archetype name of a facility prototype element."""
+    config = facility.find("config")
+    if config is None or len(config) == 0:
+        return None
+    return config[0].tag
+
+
+def scale_input(tree, n, duration=None):
+    """Scales a parsed input in place by n. Every initial deployment and
+    DeployInst build of a scaled archetype is multiplied by n, as is every
+    GrowthRegion demand. Returns the number of facilities deployed by
+    initial facility lists and DeployInsts in the scaled simulation. Raises
+    ValueError if the input has nothing to scale.
+    """
+    root = tree.getroot()
+    scaled = set()
+    for fac in root.iter("facility"):
+        if archetype_of(fac) in SCALED_ARCHETYPES:
+            scaled.add(fac.findtext("name"))
+
+    total = 0
+    nscaled = 0
+    for entry in root.iter("entry"):
+        num = entry.find("number")
+        if num is None:
+            continue
+        count = int(num.text)
+        if entry.findtext("prototype") in scaled:
+            count *= n
+            num.text = str(count)
+            nscaled += 1
+        total += count
+
+    for inst in root.iter("DeployInst"):
+        protos = [v.text.strip() for v in inst.findall("prototypes/val")]
+        builds = inst.findall("n_build/val")
+        for proto, num in zip(protos, builds):
+            count = int(num.text)
+            if proto in scaled:
+                count *= n
+                num.text = str(count)
+                nscaled += 1
+            total += count
+
+    for func in root.findall(".//GrowthRegion/growth/item/"
+                             "piecewise_function/piece/function"):
+        scale_demand(func, n)
+        nscaled += 1
+
+    if nscaled == 0:
+        raise ValueError("nothing to scale: no {0} deployments and no "
+                         "GrowthRegion demands".format(
+                             ", ".join(SCALED_ARCHETYPES)))
+
+    if duration is not None:
+        root.find("control").find("duration").text = str(duration)
+    return total
+
+
+def scale_demand(func, n):
+    """Multiplies a GrowthRegion demand function element by n."""
+    kind = func.findtext("type").strip()
+    params = [float(p) for p in func.findtext("params").split()]
+    if kind == "linear":
+        # slope and intercept
+        params = [p * n for p in params]
+    elif kind == "exponential" or kind == "exp":
+        # only the constant multiplies the curve
+        params[0] *= n
+    else:
+        raise ValueError("cannot scale a {0!r} demand function".format(kind))
+    func.find("params").text = " ".join(repr(p) for p in params)
+
+
+def step_times(lines, clock=time.time):
+    """Returns the wall time of each time step of a cyclus run, read from the
+    run's log lines as they arrive. Each 'Current time' mark starts a time
+    step, which the next mark or the end of the output closes.
+    """
+    marks = []
+    for line in lines:
+        if TIME_RE.search(line) is not None:
+            marks.append(clock())
+    if len(marks) == 0:
+        return []
+    marks.append(clock())
+    return [b - a for a, b in zip(marks[:-1], marks[1:])]
+
+
+def gen(args):
+    """Writes a scaled copy of each input for each requested size."""
+    if not os.path.isdir(args.outdir):
+        os.makedirs(args.outdir)
+    for path in args.inputs:
+        base = os.path.splitext(os.path.basename(path))[0]
+        for n in args.n:
+            tree = ET.parse(path)
+            try:
+                total = scale_input(tree, n, args.duration)
+            except ValueError as e:
+                sys.exit("{0}: {1}".format(path, e))
+            out = os.path.join(args.outdir, "{0}_x{1}.xml".format(base, n))
+            tree.write(out)
+            print("{0}: {1} facilities".format(out, total))
+
+
+def run_one(cyclus, path):
+    """Runs cyclus on one input and returns its timings."""
+    fd, db = tempfile.mkstemp(suffix=".sqlite")
+    os.close(fd)
+    os.remove(db)
+
+    cmd = [cyclus, "-v", STEP_LOG_LEVEL, "-o", db, path]
+    start = time.time()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    steps = step_times(proc.stdout)
+    proc.wait()
+    now = time.time()
+
+    # ru_maxrss is the peak over all waited-for children, which is the cyclus
+    # run since inputs are run one per process
+    rss = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    if sys.platform == "darwin":
+        rss //= 1024
+
+    size = os.path.getsize(db) if os.path.exists(db) else 0
+    if os.path.exists(db):
+        os.remove(db)
+
+    return {
+        "input": path,
+        "returncode": proc.returncode,
+        "wall_time": now - start,
+        "step_times": steps,
+        "peak_rss_kb": rss,
+        "db_size_bytes": size,
+        }
+
+
+def run(args):
+    """Times each input in its own process and writes the results as JSON."""
+    results = []
+    for path in args.inputs:
+        out = subprocess.check_output(
+            [sys.executable, __file__, "run-one", "--cyclus", args.cyclus,
+             path], universal_newlines=True)
+        res = json.loads(out)
+        print("{0}: {1:.2f} s, {2} kB peak RSS, {3} byte database".format(
+              path, res["wall_time"], res["peak_rss_kb"],
+              res["db_size_bytes"]))
+        results.append(res)
+
+    with open(args.output, "w") as f:
+        json.dump({"commit": git_commit(), "results": results}, f, indent=2)
+
+
+def run_one_main(args):
+    """Times a single input and prints the result as JSON."""
+    print(json.dumps(run_one(args.cyclus, args.input)))
+
+
+def git_commit():
+    """Returns the commit the timings were taken at, if known."""
+    here = os.path.dirname(os.path.abspath(__file__))
+    try:
+        return subprocess.check_output(
+            ["git", "rev-parse", "HEAD"], cwd=here,
+            universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("gen", help="generate scaled inputs")
+    p.add_argument("inputs", nargs="+", help="template input files")
+    p.add_argument("-n", type=int, nargs="+", default=[10, 100, 1000, 10000],
+                   help="scale factors")
+    p.add_argument("-o", "--outdir", default="scaling",
+                   help="output directory")
+    p.add_argument("-d", "--duration", type=int, default=None,
+                   help="override the simulation duration")
+    p.set_defaults(func=gen)
+
+    p = sub.add_parser("run", help="time cyclus on inputs")
+    p.add_argument("inputs", nargs="+", help="input files")
+    p.add_argument("-o", "--output", default="timings.json",
+                   help="JSON output file")
+    p.add_argument("--cyclus", default="cyclus", help="cyclus executable")
+    p.set_defaults(func=run)
+
+    p = sub.add_parser("run-one")
+    p.add_argument("input")
+    p.add_argument("--cyclus", default="cyclus")
+    p.set_defaults(func=run_one_main)
+
+    args = parser.parse_args()
+    if getattr(args, "func", None) is None:
+        parser.print_help()
+        sys.exit(1)
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+import os
+import subprocess
+import xml.etree.ElementTree as ET
+
+from nose.tools import assert_equal, assert_raises, assert_true
+from nose.plugins.skip import SkipTest
+
+import scaling
+
+INPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                     "input")
+
+
+def parse(*path):
+    return ET.parse(os.path.join(INPUT, *path))
+
+
+def test_scale_initial_facilities():
+    tree = parse("recycle.xml")
+    before = dict((e.findtext("prototype"), int(e.findtext("number")))
+                  for e in tree.getroot().iter("entry"))
+    scaling.scale_input(tree, 10)
+    scaled = set(f.findtext("name") for f in tree.getroot().iter("facility")
+                 if scaling.archetype_of(f) in scaling.SCALED_ARCHETYPES)
+    for e in tree.getroot().iter("entry"):
+        proto = e.findtext("prototype")
+        want = before[proto] * (10 if proto in scaled else 1)
+        assert_equal(want, int(e.findtext("number")))
+
+
+def test_scale_deploy_inst():
+    tree = parse("physor", "2_Sources_3_Reactors.xml")
+    total = scaling.scale_input(tree, 100)
+    inst = next(tree.getroot().iter("DeployInst"))
+    protos = [v.text for v in inst.findall("prototypes/val")]
+    builds = [int(v.text) for v in inst.findall("n_build/val")]
+    want = {"UOX_Source": 1, "MOX_Source": 1, "Reactor1": 100,
+            "Reactor2": 100, "Reactor3": 100}
+    assert_equal(want, dict(zip(protos, builds)))
+    assert_equal(302, total)
+
+
+def test_scale_growth_demand():
+    tree = parse("growth", "source_sink_linear.xml")
+    scaling.scale_input(tree, 10)
+    params = tree.getroot().find(".//GrowthRegion//function/params").text
+    assert_equal([10.0, 20.0], [float(p) for p in params.split()])
+
+
+def test_nothing_to_scale():
+    tree = parse("minimal-input", "source_1_sink_1.xml")
+    assert_raises(ValueError, scaling.scale_input, tree, 10)
+
+
+def test_step_times():
+    ticks = iter([1.0, 3.0, 6.0, 10.0])
+    lines = ["starting\n",
+             "INFO2(core  ):Current time: 0\n",
+             "some agent output\n",
+             "INFO2(core  ):Current time: 1\n",
+             "INFO2(core  ):Current time: 2\n",
+             "done\n"]
+    steps = scaling.step_times(lines, clock=lambda: next(ticks))
+    assert_equal([2.0, 3.0, 4.0], steps)
+    assert_equal([], scaling.step_times(["no marks\n"]))
+
+
+def test_step_log_level():
+    # the kernel must log one time step mark per step at STEP_LOG_LEVEL
+    path = os.path.join(INPUT, "minimal-input", "source_1_sink_1.xml")
+    duration = int(parse("minimal-input", "source_1_sink_1.xml")
+                   .getroot().findtext("control/duration"))
+    try:
+        res = scaling.run_one("cyclus", path)
+    except OSError:
+        raise SkipTest("cyclus is not installed")
+    assert_equal(0, res["returncode"])
+    assert_equal(duration, len(res["step_times"]))
+    assert_true(all(t >= 0 for t in res["step_times"]))